@@ -0,0 +1,18 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Shared by the microbenchmarks in bench/, which are linked into one binary.
+
+// Monotonic time in seconds.
+double now();
+// Calls to malloc, including those of operator new, since the start of the process.
+unsigned long allocationCount();
+
+void runParserBench();
+// Runs the channel benchmarks once per channel size.
+void runChannelBench(const std::vector<size_t>& sizes);
+
+#endif
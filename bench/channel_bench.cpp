@@ -0,0 +1,242 @@
+// Cost of the paths that grow with channel size, without the kernel: PRIVMSG
+// through Command::process (to a channel, and for comparison to a user and
+// to a missing nick), Channel::broadcastMessage, the NAMES replies and
+// getModeString. Members are synthetic connections owned by a reactor that is
+// never set up, so replies stop in their output queues, and a counting sink
+// empties the queues after each operation in place of the socket write. The
+// format rows build the 401 reply and the PRIVMSG relay line into an arena
+// alone, without the queues, whose blocks the sink gives back.
+#include <Bench.hpp>
+#include <Server.hpp>
+#include <Reactor.hpp>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <sys/resource.h>
+
+// Synthetic fds start above anything the process really has open.
+static const int FIRST_FD = 64;
+
+class ChannelFixture
+{
+	private:
+		ChannelFixture(const ChannelFixture&);
+		ChannelFixture& operator=(const ChannelFixture&);
+
+	public:
+		ServerConfig config;
+		Server server;
+		Reactor reactor;
+		NickIndex nicks;
+		ChannelTable channels;
+		Command command;
+		// Where the format rows build their lines, reset after each op like Command's.
+		Arena arena;
+		Channel* channel;
+		std::vector<int> fds;
+		std::string channel_name;
+		std::string privmsg_line;
+		std::string direct_line;
+		std::string missing_line;
+		std::string names_line;
+		std::string notice;
+		size_t checksum;
+
+		explicit ChannelFixture(size_t members);
+		~ChannelFixture();
+
+		// The counting sink: drops what was queued and returns its size. DIRTY is
+		// left set, so later ops skip re-adding the fd to the reactor's dirty list.
+		size_t drain();
+};
+
+ChannelFixture::ChannelFixture(size_t members)
+    : config(), server(config), reactor(server, config, 0, 1),
+      command(&server, server.getConnections(), nicks, channels, "password"),
+      channel(NULL), channel_name("#bench"),
+      privmsg_line("PRIVMSG #bench :hello everyone, how is it going today?"),
+      direct_line("PRIVMSG u1 :hello, how is it going today?"),
+      missing_line("PRIVMSG nobody :hello, how is it going today?"),
+      names_line("NAMES #bench"),
+      notice(":u0!~u0@localhost NOTICE #bench :hello everyone, how is it going today?\r\n"),
+      checksum(0)
+{
+    ConnectionTable& connections = server.getConnections();
+    ChannelTable::Id channel_id = channels.create(channel_name);
+    channel = channels.get(channel_id);
+    channel->setInviteOnly(true);
+    channel->setTopicRestricted(true);
+    channel->setKey("secret");
+    channel->setUserLimit(members * 2);
+
+    char nick[32];
+    for (size_t i = 0; i < members; ++i)
+	{
+        int fd = FIRST_FD + static_cast<int>(i);
+        Connection* conn = connections.add(fd, &reactor, i + 1);
+        if (!conn)
+            break;
+
+        snprintf(nick, sizeof(nick), "u%lu", static_cast<unsigned long>(i));
+        conn->user.setPasswordVerified(true);
+        NickIndex::Id nick_id = nicks.add(StringView(nick, strlen(nick)), fd);
+        conn->user.setNickname(nick_id, nicks.name(nick_id));
+        conn->user.setUsername(nick);
+        conn->user.setAuthenticated(true);
+        conn->user.addChannel(channel_id);
+
+        channel->addMember(fd);
+        if (i % 10 == 0)
+            channel->addOperator(fd);
+        fds.push_back(fd);
+    }
+}
+
+ChannelFixture::~ChannelFixture()
+{
+    // Released here because Server would otherwise close them through the reactor.
+    for (size_t i = 0; i < fds.size(); ++i)
+        server.getConnections().release(fds[i]);
+}
+
+size_t ChannelFixture::drain()
+{
+    ConnectionTable& connections = server.getConnections();
+    size_t bytes = 0;
+
+    for (size_t i = 0; i < fds.size(); ++i)
+	{
+        Connection* conn = connections.find(fds[i]);
+        if (conn->output.empty())
+            continue;
+        bytes += conn->output.size();
+        conn->output.clear();
+    }
+    return bytes;
+}
+
+static void opPrivmsg(ChannelFixture& fixture)
+{
+    fixture.command.process(fixture.fds[0], fixture.privmsg_line);
+}
+
+static void opDirect(ChannelFixture& fixture)
+{
+    fixture.command.process(fixture.fds[0], fixture.direct_line);
+}
+
+static void opMissing(ChannelFixture& fixture)
+{
+    fixture.command.process(fixture.fds[0], fixture.missing_line);
+}
+
+static void opFormatNumeric(ChannelFixture& fixture)
+{
+    StringView args[NumericTable::MAX_ARGS] = { StringView("nobody", 6), StringView(), StringView() };
+    Reply out(fixture.arena, 0);
+    fixture.server.getNumerics().render(out, ERR_NOSUCHNICK, StringView("u0", 2), args, NumericTable::MAX_ARGS);
+    fixture.checksum += out.size();
+    fixture.arena.reset();
+}
+
+static void opFormatPrivmsg(ChannelFixture& fixture)
+{
+    const User& user = fixture.server.getConnections().user(fixture.fds[0]);
+    StringView target(fixture.channel_name);
+    StringView text("hello everyone, how is it going today?", 38);
+
+    Reply out(fixture.arena, user.getFullIdentity().size() + target.size() + text.size() + 16);
+    out.add(':').add(user.getFullIdentity()).add(" PRIVMSG", 8).param(target).trailing(text).end();
+    fixture.checksum += out.size();
+    fixture.arena.reset();
+}
+
+static void opBroadcast(ChannelFixture& fixture)
+{
+    fixture.channel->broadcastMessage(fixture.server, fixture.notice, fixture.fds[0]);
+}
+
+static void opNames(ChannelFixture& fixture)
+{
+    fixture.command.process(fixture.fds[0], fixture.names_line);
+}
+
+static void opModeString(ChannelFixture& fixture)
+{
+    fixture.checksum += fixture.channel->getModeString().size();
+}
+
+// Times batches of `batch` calls and drains the queues between batches, outside the timing.
+static void measure(const char* name, ChannelFixture& fixture, void (*op)(ChannelFixture&), size_t iterations, size_t batch)
+{
+    op(fixture);
+    fixture.drain();
+
+    double elapsed = 0;
+    unsigned long allocations = 0;
+    size_t bytes = 0;
+    size_t done = 0;
+
+    while (done < iterations)
+	{
+        unsigned long allocated = allocationCount();
+        double start = now();
+        for (size_t i = 0; i < batch; ++i)
+            op(fixture);
+        elapsed += now() - start;
+        allocations += allocationCount() - allocated;
+
+        bytes += fixture.drain();
+        done += batch;
+    }
+
+    char row[160];
+    snprintf(row, sizeof(row), "%-22s %8lu members %12.0f ns/op %10.1f allocs/op %10lu bytes/op",
+             name, static_cast<unsigned long>(fixture.fds.size()), elapsed * 1e9 / done,
+             static_cast<double>(allocations) / done, static_cast<unsigned long>(bytes / done));
+    std::cout << row << std::endl;
+}
+
+// One synthetic connection per member needs a descriptor limit above the largest size;
+// the table is sized from it. Raising the hard limit only works with CAP_SYS_RESOURCE.
+static void raiseDescriptorLimit(size_t needed)
+{
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) < 0 || limit.rlim_cur >= needed)
+        return;
+
+    struct rlimit wanted = limit;
+    wanted.rlim_cur = needed;
+    if (wanted.rlim_max < needed)
+        wanted.rlim_max = needed;
+    if (setrlimit(RLIMIT_NOFILE, &wanted) < 0)
+	{
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+void runChannelBench(const std::vector<size_t>& sizes)
+{
+    size_t largest = 0;
+    for (size_t i = 0; i < sizes.size(); ++i)
+        largest = std::max(largest, sizes[i]);
+    raiseDescriptorLimit(FIRST_FD + largest);
+
+    for (size_t i = 0; i < sizes.size(); ++i)
+	{
+        ChannelFixture fixture(sizes[i]);
+        if (fixture.fds.size() < sizes[i])
+            std::cout << "descriptor limit: channel of " << sizes[i] << " reduced to " << fixture.fds.size() << " members" << std::endl;
+
+        size_t iterations = std::max<size_t>(20, 2000000 / sizes[i]);
+        measure("PRIVMSG (process)", fixture, opPrivmsg, iterations, 1);
+        measure("PRIVMSG (to a user)", fixture, opDirect, 200000, 1);
+        measure("PRIVMSG (401 reply)", fixture, opMissing, 200000, 1);
+        measure("401 reply (format)", fixture, opFormatNumeric, 1000000, 1000);
+        measure("PRIVMSG line (format)", fixture, opFormatPrivmsg, 1000000, 1000);
+        measure("broadcastMessage", fixture, opBroadcast, iterations, 1);
+        measure("NAMES", fixture, opNames, iterations, 1);
+        measure("getModeString", fixture, opModeString, 1000000, 1000);
+    }
+}
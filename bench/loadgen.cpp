@@ -0,0 +1,489 @@
+// End-to-end load generator. Opens many client connections to a running
+// ircserv, registers them, spreads them over channels and sends PRIVMSG at a
+// target rate. Every message carries its send time, so each delivery gives
+// one latency sample; the report has throughput and p50/p99/p999.
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cerrno>
+#include <ctime>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+struct Options
+{
+    std::string host;
+    std::string port;
+    std::string password;
+    long clients;
+    long channels;
+    long rate;
+    long duration;
+    long size;
+
+    Options() : host("127.0.0.1"), clients(1000), channels(10), rate(10000), duration(10), size(64) {}
+};
+
+struct Client
+{
+    int fd;
+    long channel;
+    bool ready;
+    bool writable;
+    std::string input;
+    std::string output;
+};
+
+// Microsecond buckets up to 10 ms, then 100 us buckets up to 10 s; later
+// samples go to the last bucket.
+class LatencyHistogram
+{
+	private:
+		static const unsigned long FINE = 10000;
+		static const unsigned long COARSE = 100000;
+
+		std::vector<unsigned long> counts;
+		unsigned long total;
+		unsigned long max;
+
+	public:
+		LatencyHistogram() : counts(FINE + COARSE, 0), total(0), max(0) {}
+
+		void add(unsigned long micros);
+		unsigned long count() const;
+		unsigned long maximum() const;
+		unsigned long quantile(double q) const;
+};
+
+void LatencyHistogram::add(unsigned long micros)
+{
+    size_t bucket = micros < FINE ? micros : FINE + (micros - FINE) / 100;
+    if (bucket >= counts.size())
+        bucket = counts.size() - 1;
+    ++counts[bucket];
+    ++total;
+    if (micros > max)
+        max = micros;
+}
+
+unsigned long LatencyHistogram::count() const
+{
+    return total;
+}
+
+unsigned long LatencyHistogram::maximum() const
+{
+    return max;
+}
+
+// Lower bound of the bucket holding the given quantile.
+unsigned long LatencyHistogram::quantile(double q) const
+{
+    unsigned long rank = static_cast<unsigned long>(q * total);
+    unsigned long seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i)
+	{
+        seen += counts[i];
+        if (seen > rank)
+            return i < FINE ? i : FINE + (i - FINE) * 100;
+    }
+    return max;
+}
+
+static int epoll_fd = -1;
+static std::vector<Client> clients;
+static std::vector<long> channel_ready;
+static long ready_count = 0;
+static unsigned long delivered = 0;
+static unsigned long failures = 0;
+static LatencyHistogram latencies;
+
+static unsigned long nowNanoseconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+static bool parseNumber(const std::string& value, long& out)
+{
+    char* end = NULL;
+    errno = 0;
+    long number = std::strtol(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || errno != 0 || number <= 0)
+        return false;
+    out = number;
+    return true;
+}
+
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+    if (argc < 3)
+        return false;
+
+    options.port = argv[1];
+    options.password = argv[2];
+
+    for (int i = 3; i < argc; ++i)
+	{
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0 || equals == std::string::npos)
+            return false;
+
+        std::string name = arg.substr(0, equals);
+        std::string value = arg.substr(equals + 1);
+
+        if (name == "--host")
+            options.host = value;
+        else if (name == "--clients")
+		{
+            if (!parseNumber(value, options.clients))
+                return false;
+        }
+        else if (name == "--channels")
+		{
+            if (!parseNumber(value, options.channels))
+                return false;
+        }
+        else if (name == "--rate")
+		{
+            if (!parseNumber(value, options.rate))
+                return false;
+        }
+        else if (name == "--duration")
+		{
+            if (!parseNumber(value, options.duration))
+                return false;
+        }
+        else if (name == "--size")
+		{
+            if (!parseNumber(value, options.size) || options.size > 400)
+                return false;
+        }
+        else
+            return false;
+    }
+    return true;
+}
+
+static void printUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " <port> <password> [options]" << std::endl
+              << "  --host=ADDRESS      server address (default: 127.0.0.1)" << std::endl
+              << "  --clients=N         concurrent connections (default: 1000)" << std::endl
+              << "  --channels=N        channels the clients are spread over (default: 10)" << std::endl
+              << "  --rate=N            PRIVMSG sent per second, all clients together (default: 10000)" << std::endl
+              << "  --duration=SECONDS  length of the send phase (default: 10)" << std::endl
+              << "  --size=BYTES        padding added to each message, at most 400 (default: 64)" << std::endl;
+}
+
+// Thousands of sockets need more than the usual soft limit of 1024.
+static void raiseFileLimit()
+{
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+	{
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+static void watch(size_t index, bool want_write)
+{
+    struct epoll_event ev;
+    ev.events = want_write ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    ev.data.u64 = index;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, clients[index].fd, &ev);
+}
+
+static void closeClient(size_t index)
+{
+    Client& client = clients[index];
+    if (client.fd < 0)
+        return;
+
+    if (client.ready)
+	{
+        --channel_ready[client.channel];
+        --ready_count;
+    }
+    close(client.fd);
+    client.fd = -1;
+    client.ready = false;
+    ++failures;
+}
+
+static void flush(size_t index)
+{
+    Client& client = clients[index];
+    while (!client.output.empty())
+	{
+        ssize_t sent = send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+        if (sent < 0)
+		{
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+                closeClient(index);
+                return;
+            }
+            break;
+        }
+        client.output.erase(0, sent);
+    }
+
+    bool want_write = !client.output.empty();
+    if (want_write != client.writable)
+	{
+        client.writable = want_write;
+        watch(index, want_write);
+    }
+}
+
+static void queue(size_t index, const std::string& line)
+{
+    if (clients[index].fd < 0)
+        return;
+    clients[index].output += line;
+    flush(index);
+}
+
+static void handleLine(size_t index, const std::string& line)
+{
+    Client& client = clients[index];
+
+    size_t privmsg = line.find(" PRIVMSG ");
+    if (privmsg != std::string::npos)
+	{
+        size_t stamp = line.find(" :lg ", privmsg);
+        if (stamp != std::string::npos)
+		{
+            unsigned long sent_at = std::strtoul(line.c_str() + stamp + 5, NULL, 10);
+            unsigned long now = nowNanoseconds();
+            latencies.add(now > sent_at ? (now - sent_at) / 1000 : 0);
+            ++delivered;
+        }
+        return;
+    }
+
+    if (line.compare(0, 5, "PING ") == 0)
+	{
+        queue(index, "PONG " + line.substr(5) + "\r\n");
+        return;
+    }
+
+    // End of the NAMES list that follows our JOIN: the client can send.
+    if (!client.ready && line.find(" 366 ") != std::string::npos)
+	{
+        client.ready = true;
+        ++channel_ready[client.channel];
+        ++ready_count;
+    }
+}
+
+static void readClient(size_t index)
+{
+    char buffer[16384];
+
+    while (clients[index].fd >= 0)
+	{
+        ssize_t received = recv(clients[index].fd, buffer, sizeof(buffer), 0);
+        if (received == 0)
+		{
+            closeClient(index);
+            return;
+        }
+        if (received < 0)
+		{
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                closeClient(index);
+            return;
+        }
+
+        std::string& input = clients[index].input;
+        input.append(buffer, received);
+
+        size_t start = 0;
+        size_t end;
+        while ((end = input.find("\r\n", start)) != std::string::npos)
+		{
+            handleLine(index, input.substr(start, end - start));
+            start = end + 2;
+        }
+        input.erase(0, start);
+    }
+}
+
+static void pollEvents(int timeout_ms)
+{
+    struct epoll_event events[256];
+    int count = epoll_wait(epoll_fd, events, 256, timeout_ms);
+
+    for (int i = 0; i < count; ++i)
+	{
+        size_t index = events[i].data.u64;
+        if (clients[index].fd < 0)
+            continue;
+        if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+            readClient(index);
+        if (clients[index].fd >= 0 && (events[i].events & EPOLLOUT))
+            flush(index);
+    }
+}
+
+static bool connectClients(const Options& options)
+{
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* address = NULL;
+    int error = getaddrinfo(options.host.c_str(), options.port.c_str(), &hints, &address);
+    if (error != 0)
+	{
+        std::cerr << "Error resolving " << options.host << ": " << gai_strerror(error) << std::endl;
+        return false;
+    }
+
+    clients.resize(options.clients);
+    channel_ready.assign(options.channels, 0);
+
+    for (long i = 0; i < options.clients; ++i)
+	{
+        Client& client = clients[i];
+        client.channel = i % options.channels;
+        client.ready = false;
+        client.writable = false;
+
+        client.fd = socket(address->ai_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (client.fd < 0 || connect(client.fd, address->ai_addr, address->ai_addrlen) < 0)
+		{
+            std::cerr << "Error connecting client " << i << ": " << strerror(errno) << std::endl;
+            if (client.fd >= 0)
+                close(client.fd);
+            freeaddrinfo(address);
+            return false;
+        }
+
+        int opt = 1;
+        setsockopt(client.fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+        fcntl(client.fd, F_SETFL, fcntl(client.fd, F_GETFL) | O_NONBLOCK);
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.u64 = i;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client.fd, &ev);
+
+        char nick[32];
+        char channel[32];
+        snprintf(nick, sizeof(nick), "lg%ld", i);
+        snprintf(channel, sizeof(channel), "#bench%ld", client.channel);
+        queue(i, "PASS " + options.password + "\r\nNICK " + nick + "\r\nUSER " + nick
+                 + " 0 * :load generator\r\nJOIN " + channel + "\r\n");
+
+        // Keep the server's accept queue and our receive buffers moving.
+        if (i % 64 == 63)
+            pollEvents(0);
+    }
+
+    freeaddrinfo(address);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+	{
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    raiseFileLimit();
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+	{
+        std::cerr << "Error creating epoll instance: " << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    unsigned long phase_start = nowNanoseconds();
+    if (!connectClients(options))
+        return 1;
+
+    while (ready_count + static_cast<long>(failures) < options.clients
+           && nowNanoseconds() - phase_start < 30000000000UL)
+        pollEvents(10);
+
+    std::cout << ready_count << "/" << options.clients << " clients registered and joined in "
+              << (nowNanoseconds() - phase_start) / 1000000 << " ms" << std::endl;
+    if (ready_count == 0)
+        return 1;
+
+    std::string padding(options.size, 'x');
+    unsigned long sent = 0;
+    unsigned long expected = 0;
+    size_t next_sender = 0;
+
+    // Sends whatever the schedule says is due, then waits at most 1 ms for replies.
+    unsigned long send_start = nowNanoseconds();
+    unsigned long send_end = send_start + options.duration * 1000000000UL;
+    unsigned long now;
+    while ((now = nowNanoseconds()) < send_end)
+	{
+        unsigned long due = (now - send_start) / 1000 * options.rate / 1000000;
+        for (; sent < due; ++sent)
+		{
+            size_t tries = 0;
+            while (!clients[next_sender].ready && tries++ < clients.size())
+                next_sender = (next_sender + 1) % clients.size();
+            if (!clients[next_sender].ready)
+                break;
+
+            Client& sender = clients[next_sender];
+            char head[64];
+            snprintf(head, sizeof(head), "PRIVMSG #bench%ld :lg %lu ", sender.channel, nowNanoseconds());
+            queue(next_sender, head + padding + "\r\n");
+            expected += channel_ready[sender.channel] - 1;
+            next_sender = (next_sender + 1) % clients.size();
+        }
+        pollEvents(1);
+    }
+
+    // Let in-flight deliveries arrive.
+    unsigned long drain_end = nowNanoseconds() + 2000000000UL;
+    while (delivered < expected && nowNanoseconds() < drain_end)
+        pollEvents(10);
+
+    double seconds = (nowNanoseconds() - send_start) / 1e9;
+    std::cout << "sent " << sent << " messages in " << options.duration << " s (" << sent / options.duration << "/s)" << std::endl
+              << "delivered " << delivered << " of " << expected << " expected ("
+              << static_cast<unsigned long>(delivered / seconds) << " deliveries/s)" << std::endl;
+    if (latencies.count() > 0)
+        std::cout << "latency us: p50 " << latencies.quantile(0.50) << "  p99 " << latencies.quantile(0.99)
+                  << "  p999 " << latencies.quantile(0.999) << "  max " << latencies.maximum() << std::endl;
+    if (failures > 0)
+        std::cout << failures << " connections were closed by the server" << std::endl;
+
+    for (size_t i = 0; i < clients.size(); ++i)
+	{
+        if (clients[i].fd >= 0)
+            close(clients[i].fd);
+    }
+    close(epoll_fd);
+    return 0;
+}
@@ -0,0 +1,81 @@
+// Entry point of the microbenchmarks. malloc is replaced to count allocations,
+// so each benchmark can report allocs/op next to ns/op; operator new goes
+// through it, and so do the SharedBuffer blocks, which are malloc'd directly.
+#include <Bench.hpp>
+#include <iostream>
+#include <cstdlib>
+#include <new>
+#include <ctime>
+
+static unsigned long allocations = 0;
+
+// glibc's allocator, which the replacement forwards to.
+extern "C" void* __libc_malloc(size_t size);
+
+extern "C" void* malloc(size_t size) throw()
+{
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void* operator new(size_t size) throw(std::bad_alloc)
+{
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size) throw(std::bad_alloc)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) throw()
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) throw()
+{
+    std::free(ptr);
+}
+
+double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+unsigned long allocationCount()
+{
+    return __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+}
+
+// Usage: microbench [CHANNEL_SIZE...]
+int main(int argc, char** argv)
+{
+    std::vector<size_t> sizes;
+    for (int i = 1; i < argc; ++i)
+	{
+        long size = std::atol(argv[i]);
+        if (size < 2)
+		{
+            std::cerr << "Usage: " << argv[0] << " [CHANNEL_SIZE...] (sizes of at least 2)" << std::endl;
+            return 1;
+        }
+        sizes.push_back(static_cast<size_t>(size));
+    }
+    if (sizes.empty())
+	{
+        sizes.push_back(10);
+        sizes.push_back(1000);
+        sizes.push_back(100000);
+    }
+
+    runParserBench();
+    std::cout << std::endl;
+    runChannelBench(sizes);
+    return 0;
+}
@@ -0,0 +1,115 @@
+// Lines per second through command parsing and dispatch lookup, comparing the
+// former istringstream tokenizer with Message and the route table.
+#include <Bench.hpp>
+#include <Command.hpp>
+#include <Message.hpp>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+
+static const char* corpus[] = {
+    "PRIVMSG #general :hello everyone, how is it going today?",
+    "PRIVMSG alice :are you around for a quick review of the patch?",
+    "JOIN #general,#random",
+    "MODE #general +o bob",
+    "KICK #general mallory :spamming the channel",
+    "TOPIC #general :Release planning, Thursday 14:00",
+    "NICK carol",
+    "PART #random :see you later",
+    "INVITE dave #private",
+    "@time=2024-01-01T00:00:00.000Z :alice!~alice@host PRIVMSG #general :tagged line",
+};
+static const size_t corpus_size = sizeof(corpus) / sizeof(corpus[0]);
+static const size_t iterations = 2000000;
+
+// What Command::process and the handlers did per line before Message existed:
+// one istringstream for the verb, an uppercased copy, a compare chain, then a
+// substr and a second istringstream inside the handler.
+static size_t legacyParse(const StringView& view)
+{
+    std::string line = view.str();
+    std::istringstream iss(line);
+    std::string command;
+    iss >> command;
+    std::transform(command.begin(), command.end(), command.begin(), ::toupper);
+
+    size_t sink = 0;
+    if (command == "PASS" || command == "NICK" || command == "JOIN")
+	{
+        std::string param;
+        std::getline(iss, param);
+        sink += param.size();
+    }
+    else if (command == "PRIVMSG")
+	{
+        std::string target, message;
+        iss >> target;
+        std::getline(iss, message);
+        if (!message.empty() && message[0] == ' ') message = message.substr(1);
+        if (!message.empty() && message[0] == ':') message = message.substr(1);
+        sink += target.size() + message.size();
+    }
+    else if (command == "USER" || command == "PART" || command == "QUIT" || command == "KICK"
+             || command == "INVITE" || command == "TOPIC" || command == "MODE")
+	{
+        std::istringstream params(line.substr(command.size() < line.size() ? command.size() + 1 : line.size()));
+        std::string first, second;
+        params >> first >> second;
+        sink += first.size() + second.size();
+    }
+    return sink + command.size();
+}
+
+static size_t messageParse(const Command& command, const StringView& view)
+{
+    Message msg;
+    if (!msg.parse(view))
+        return 0;
+
+    size_t sink = command.findHandler(msg.getCommand()) != NULL;
+    for (size_t i = 0; i < msg.paramCount(); ++i)
+        sink += msg.param(i).size();
+    return sink;
+}
+
+static void report(const char* name, double seconds, unsigned long allocations, size_t lines)
+{
+    std::cout << name << ": " << static_cast<unsigned long>(lines / seconds) << " lines/s ("
+              << seconds * 1e9 / lines << " ns/line, "
+              << static_cast<double>(allocations) / lines << " allocs/line)" << std::endl;
+}
+
+void runParserBench()
+{
+    ConnectionTable connections;
+    NickIndex nicks;
+    ChannelTable channels;
+    Command command(NULL, connections, nicks, channels, "password");
+
+    StringView lines[corpus_size];
+    for (size_t i = 0; i < corpus_size; ++i)
+        lines[i] = StringView(corpus[i], std::char_traits<char>::length(corpus[i]));
+
+    size_t sink = 0;
+    size_t total = iterations / 10;
+
+    unsigned long allocations = allocationCount();
+    double start = now();
+    for (size_t i = 0; i < total; ++i)
+        sink += legacyParse(lines[i % corpus_size]);
+    double legacy = now() - start;
+    unsigned long legacy_allocations = allocationCount() - allocations;
+
+    allocations = allocationCount();
+    start = now();
+    for (size_t i = 0; i < iterations; ++i)
+        sink += messageParse(command, lines[i % corpus_size]);
+    double parsed = now() - start;
+    unsigned long parsed_allocations = allocationCount() - allocations;
+
+    report("istringstream + compare chain", legacy, legacy_allocations, total);
+    report("Message + route table        ", parsed, parsed_allocations, iterations);
+    std::cout << "speedup: " << (parsed / iterations > 0 ? (legacy / total) / (parsed / iterations) : 0) << "x"
+              << " (checksum " << sink << ")" << std::endl;
+}
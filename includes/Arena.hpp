@@ -0,0 +1,47 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+
+// Bump allocator for data that only lives while one command is handled:
+// replies are formatted into it and Command::process resets it on return.
+// Memory comes from a chain of blocks. reset() keeps a single block, sized
+// for the largest command seen so far (up to MAX_RETAINED), so a command
+// that fits performs no heap allocation at all.
+class Arena
+{
+	public:
+		static const size_t BLOCK_SIZE = 4096;
+		static const size_t MAX_RETAINED = 64 * 1024;
+
+	private:
+		struct Block
+		{
+			Block* next;
+			size_t size;
+			size_t used;
+			char data[1];
+		};
+
+		Block* head;
+		// Bytes handed out since the last reset, over every block.
+		size_t total;
+		size_t high_water;
+
+		static Block* newBlock(size_t size, Block* next);
+		void releaseBlocks();
+
+		Arena(const Arena&);
+		Arena& operator=(const Arena&);
+
+	public:
+		Arena();
+		~Arena();
+
+		char* allocate(size_t size);
+		// Grows the most recent allocation in place when its block has room.
+		bool extend(char* ptr, size_t size, size_t new_size);
+		void reset();
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef CASEMAPPING_HPP
+#define CASEMAPPING_HPP
+
+#include <string>
+#include <StringView.hpp>
+
+// rfc1459 case mapping: A-Z, [, ], \ and ~ are the upper case of a-z, {, }, | and ^.
+char ircToLower(char c);
+std::string ircFold(const std::string& name);
+// Folds into a caller-owned buffer, so that repeated lookups reuse its storage.
+void ircFold(const StringView& name, std::string& folded);
+
+// A hash key that hashes and compares a name by its fold without writing the
+// fold anywhere, so that lookups from several reactors share no buffer. It
+// points at bytes owned elsewhere, which must not change while it is a key.
+struct FoldedKey
+{
+	const char* data;
+	size_t size;
+
+	FoldedKey(const StringView& name);
+};
+
+struct FoldedHash
+{
+	size_t operator()(const FoldedKey& key) const;
+};
+
+struct FoldedEqual
+{
+	bool operator()(const FoldedKey& a, const FoldedKey& b) const;
+};
+
+#endif
@@ -2,16 +2,38 @@
 #define CHANNEL_HPP
 
 #include <string>
-#include <set>
+#include <vector>
+#include <SharedBuffer.hpp>
+
+class Server;
+class ConnectionTable;
+class NickIndex;
 
 class Channel
 {
+	public:
+		enum MemberFlags
+		{
+			JOINED = 1,
+			OPERATOR = 2,
+			INVITED = 4
+		};
+
+		// One record per client that joined or was invited, sorted by fd.
+		struct Member
+		{
+			int fd;
+			unsigned int flags;
+		};
+
 	private:
 		std::string name;
+		// rfc1459 fold of name, the key ChannelTable hashes.
+		std::string folded_name;
 		std::string topic;
-		std::set<int> members;
-		std::set<int> operators;
-		std::set<int> invited;
+		std::vector<Member> members;
+		size_t member_count;
+		size_t operator_count;
 
 		bool inviteOnly;
 		bool topicRestricted;
@@ -20,15 +42,33 @@ class Channel
 		std::string key;
 		size_t userLimit;
 
+		// NAMES payload cache, rebuilt on first use after a part, op or nick
+		// change. Joins are queued in names_pending and appended to the last
+		// chunk on the next use, so a join storm does not rebuild it each time.
+		mutable std::vector<std::string> names;
+		mutable std::vector<int> names_pending;
+		mutable size_t names_chunk;
+		mutable bool names_valid;
+
+		void appendName(const ConnectionTable& connections, const NickIndex& nicks, int client_fd, bool is_operator) const;
+
+		std::vector<Member>::iterator locate(int client_fd);
+		unsigned int flagsOf(int client_fd) const;
+		bool setFlag(int client_fd, unsigned int flag);
+		bool clearFlag(int client_fd, unsigned int flag);
+
 	public:
 		Channel();
 		explicit Channel(const std::string& channelName);
 		~Channel();
 
 		const std::string& getName() const;
+		const std::string& getFoldedName() const;
 		const std::string& getTopic() const;
-		const std::set<int>& getMembers() const;
-		const std::set<int>& getOperators() const;
+		// Includes invited non-members: check JOINED when iterating.
+		const std::vector<Member>& getMembers() const;
+		size_t getMemberCount() const;
+		size_t getOperatorCount() const;
 
 		void setName(const std::string& channelName);
 		void setTopic(const std::string& channelTopic);
@@ -37,6 +77,8 @@ class Channel
 		bool removeMember(int client_fd);
 		bool hasMember(int client_fd) const;
 		bool isEmpty() const;
+		// The member to promote if client_fd, the last operator, leaves; -1 if none is needed.
+		int operatorSuccessor(int client_fd) const;
 
 		bool addOperator(int client_fd);
 		bool removeOperator(int client_fd);
@@ -62,7 +104,15 @@ class Channel
 
 		std::string getModeString() const;
 
-		void broadcastMessage(const std::string& message,
+		// Joined members, operators prefixed with '@', in space-separated
+		// chunks of at most chunk_size bytes (one nick per chunk if longer).
+		const std::vector<std::string>& getNames(const ConnectionTable& connections, const NickIndex& nicks,
+			size_t chunk_size) const;
+		void invalidateNames();
+
+		void broadcastMessage(Server& server, const std::string& message,
+			int excludeClient = -1) const;
+		void broadcastMessage(Server& server, const SharedBuffer& message,
 			int excludeClient = -1) const;
 };
 
@@ -0,0 +1,56 @@
+#ifndef CHANNELTABLE_HPP
+#define CHANNELTABLE_HPP
+
+#include <string>
+#include <vector>
+#include <tr1/unordered_map>
+#include <StringView.hpp>
+#include <Channel.hpp>
+#include <CaseMapping.hpp>
+
+// Channels by interned id, hashed by the folded name each Channel computes
+// once when it is created; users keep ids rather than names, and the display
+// name stored in the Channel is only read back to format replies. Channels
+// are heap records, so ids and references stay valid while others are
+// created and erased; the ids of erased channels are reused.
+class ChannelTable
+{
+	public:
+		typedef unsigned int Id;
+		static const Id NONE = ~0u;
+
+	private:
+		// Keyed by each channel's folded name; lookups fold as they hash, so
+		// reactors holding only their share of the state lock can run them at once.
+		std::tr1::unordered_map<FoldedKey, Id, FoldedHash, FoldedEqual> ids;
+		std::vector<Channel*> slots;
+		std::vector<Id> free_ids;
+
+		ChannelTable(const ChannelTable&);
+		ChannelTable& operator=(const ChannelTable&);
+
+	public:
+		ChannelTable();
+		~ChannelTable();
+
+		// Case-insensitive lookup; NONE if no channel has that name.
+		Id find(const StringView& name) const;
+		// NULL for an id that is not in use.
+		Channel* get(Id id) const;
+		// Returns the id of the channel named name, creating it if needed.
+		Id create(const std::string& name);
+		void erase(Id id);
+		void clear();
+
+		size_t size() const;
+		// Ids are below this bound; get() returns NULL for the unused ones.
+		Id bound() const;
+};
+
+// Defined here so that resolving the ids a user keeps costs no call.
+inline Channel* ChannelTable::get(Id id) const
+{
+    return id < slots.size() ? slots[id] : NULL;
+}
+
+#endif
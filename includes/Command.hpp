@@ -2,39 +2,107 @@
 #define COMMAND_HPP
 
 #include <string>
-#include <sstream>
-#include <map>
 #include <User.hpp>
+#include <ConnectionTable.hpp>
 #include <Channel.hpp>
+#include <ChannelTable.hpp>
+#include <NickIndex.hpp>
+#include <Message.hpp>
+#include <Metrics.hpp>
+#include <StringView.hpp>
+#include <Arena.hpp>
+#include <Reply.hpp>
+#include <NumericTable.hpp>
 
 class Server;
 
 class Command
 {
+	public:
+		typedef void (Command::*Handler)(int client_fd, const Message& msg);
+
 	private:
+		struct Route
+		{
+			const char* verb;
+			size_t length;
+			Handler handler;
+			unsigned int cost;
+			// Only reads the shared state, so a reactor's share of the lock is enough.
+			bool shared;
+			Metrics::Histogram* latency;
+			Metrics::Counter* bytes;
+		};
+
+		// Open-addressed verb table, filled once by the constructor.
+		static const size_t ROUTE_SLOTS = 64;
+
 		Server* server;
-		std::map<int, User>& users;
-		std::map<std::string, Channel>& channels;
+		ConnectionTable& connections;
+		NickIndex& nicks;
+		ChannelTable& channels;
 		std::string password;
+		Route routes[ROUTE_SLOTS];
+		// Replies of the command being processed; reset when process returns.
+		Arena arena;
+
+		static size_t hashVerb(const char* verb, size_t length);
+		void addRoute(const char* verb, Handler handler, unsigned int cost, bool shared = false);
+		const Route* findRoute(const StringView& verb) const;
+		// The stored spelling of a client's nickname; the client must have one.
+		const std::string& nickOf(int client_fd) const;
+		// Spends flood control tokens and input bytes of a connection.
+		void charge(int client_fd, unsigned int tokens, size_t bytes);
+		// Renders a numeric from the server's templates into out, addressed to
+		// the client's nick, or "*" before registration.
+		void appendNumeric(Reply& out, int client_fd, Numeric numeric, const StringView& first = StringView(),
+						   const StringView& second = StringView(), const StringView& third = StringView());
 
 	public:
-		Command(Server* server, std::map<int, User>& users, std::map<std::string, Channel>& channels, const std::string& password);
+		// Flood control costs in command tokens: commands that walk a channel or
+		// check credentials cost more, and fan-out adds a token per RECIPIENTS_PER_TOKEN.
+		static const unsigned int COST_DEFAULT = 1;
+		static const unsigned int COST_HEAVY = 3;
+		static const size_t RECIPIENTS_PER_TOKEN = 100;
+		// Requester nick length the cached NAMES chunks are sized for.
+		static const size_t NAMES_NICK_BUDGET = 30;
+
+		Command(Server* server, ConnectionTable& connections, NickIndex& nicks,
+				ChannelTable& channels, const std::string& password);
 		~Command();
 
-		void process(int client_fd, const std::string& line);
+		// Case-insensitive verb lookup; NULL for an unknown command.
+		Handler findHandler(const StringView& verb) const;
+		// True when processing line only reads the shared state: a shared route,
+		// or a line answered with an error numeric alone.
+		bool isShared(const StringView& line) const;
+
+		void process(int client_fd, const StringView& view);
+		// Sends a single numeric reply, formatted in the arena.
+		void reply(int client_fd, Numeric numeric, const StringView& first = StringView(),
+				   const StringView& second = StringView(), const StringView& third = StringView());
+		void replyInputTooLong(int client_fd);
 		void sendWelcomeMessages(int client_fd, const User& user);
+		// 353/366 replies listing the joined members, operators prefixed with '@',
+		// in as many 353 lines as needed to stay within 512 bytes each.
+		void sendNames(int client_fd, const Channel& channel);
 
-		void handlePass(int client_fd, std::istringstream& iss);
-		void handleNick(int client_fd, std::istringstream& iss);
-		void handleUser(int client_fd, const std::string& line);
-		void handleJoin(int client_fd, std::istringstream& iss);
-		void handlePrivmsg(int client_fd, std::istringstream &iss);
-		void handlePart(int client_fd, const std::string &line);
-		void handleQuit(int client_fd, const std::string &line);
-		void handleKick(int client_fd, const std::string &line);
-		void handleInvite(int client_fd, const std::string& line);
-		void handleTopic(int client_fd, const std::string& line);
-		void handleMode(int client_fd, const std::string& line);
+		void handlePass(int client_fd, const Message& msg);
+		void handleNick(int client_fd, const Message& msg);
+		void handleUser(int client_fd, const Message& msg);
+		void handleJoin(int client_fd, const Message& msg);
+		void handlePrivmsg(int client_fd, const Message& msg);
+		void handlePart(int client_fd, const Message& msg);
+		void handleQuit(int client_fd, const Message& msg);
+		void handleKick(int client_fd, const Message& msg);
+		void handleInvite(int client_fd, const Message& msg);
+		void handleTopic(int client_fd, const Message& msg);
+		void handleMode(int client_fd, const Message& msg);
+		void handleOper(int client_fd, const Message& msg);
+		void handleStats(int client_fd, const Message& msg);
+		void handlePing(int client_fd, const Message& msg);
+		void handlePong(int client_fd, const Message& msg);
+		void handleNames(int client_fd, const Message& msg);
 };
 
 #endif
@@ -0,0 +1,103 @@
+#ifndef CONNECTIONTABLE_HPP
+#define CONNECTIONTABLE_HPP
+
+#include <cstddef>
+#include <vector>
+#include <User.hpp>
+#include <InputBuffer.hpp>
+#include <OutputQueue.hpp>
+#include <FloodControl.hpp>
+#include <TimerWheel.hpp>
+
+class Reactor;
+
+// Everything the server keeps about one client, in a single record.
+// The user fields are guarded by the state lock; input, output and flags
+// are only touched by the owning reactor's thread.
+struct Connection
+{
+	enum Flags
+	{
+		IN_USE = 1,
+		CLOSING = 2,
+		DIRTY = 4,
+		THROTTLED = 8,
+		PING_SENT = 16
+	};
+
+	int fd;
+	unsigned long id;
+	unsigned int flags;
+	int next_free;
+	Reactor* reactor;
+	User user;
+	InputBuffer input;
+	OutputQueue output;
+	FloodControl flood;
+	// Wheel tick of the last read; the keepalive timer fires at most once per
+	// ping interval and works out from this whether the client was idle.
+	unsigned long last_activity;
+	TimerWheel::Timer keepalive;
+	TimerWheel::Timer flood_timer;
+};
+
+// Connection records indexed by fd. Records live in fixed-size pages that are
+// never moved or freed, and released slots are reused through a free list, so a
+// lookup is two array reads. Slots are added and released under the state lock.
+class ConnectionTable
+{
+	private:
+		static const size_t PAGE_SIZE = 64;
+
+		std::vector<int> slot_by_fd;
+		std::vector<Connection*> pages;
+		size_t slot_count;
+		int free_head;
+		size_t live;
+
+		Connection& slot(int index) const;
+
+		ConnectionTable(const ConnectionTable&);
+		ConnectionTable& operator=(const ConnectionTable&);
+
+	public:
+		ConnectionTable();
+		~ConnectionTable();
+
+		// NULL when fd is past the descriptor limit.
+		Connection* add(int fd, Reactor* reactor, unsigned long id);
+		void release(int fd);
+
+		Connection* find(int fd) const;
+		bool contains(int fd) const;
+		// fd must be registered.
+		User& user(int fd) const;
+
+		size_t size() const;
+		void listFds(std::vector<int>& fds) const;
+};
+
+// Defined here so that every handler lookup is inlined.
+inline Connection& ConnectionTable::slot(int index) const
+{
+    return pages[index / PAGE_SIZE][index % PAGE_SIZE];
+}
+
+inline Connection* ConnectionTable::find(int fd) const
+{
+    if (fd < 0 || static_cast<size_t>(fd) >= slot_by_fd.size() || slot_by_fd[fd] < 0)
+        return NULL;
+    return &slot(slot_by_fd[fd]);
+}
+
+inline bool ConnectionTable::contains(int fd) const
+{
+    return find(fd) != NULL;
+}
+
+inline User& ConnectionTable::user(int fd) const
+{
+    return slot(slot_by_fd[fd]).user;
+}
+
+#endif
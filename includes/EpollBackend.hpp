@@ -0,0 +1,59 @@
+#ifndef EPOLLBACKEND_HPP
+#define EPOLLBACKEND_HPP
+
+#include <vector>
+#include <sys/epoll.h>
+#include <EventBackend.hpp>
+
+// Readiness-based backend: epoll_wait, then one recv or sendmsg per ready socket.
+class EpollBackend : public EventBackend
+{
+	private:
+		const ServerConfig& config;
+		int epoll_fd;
+		int listen_fd;
+		bool accept_pending;
+		std::vector<struct epoll_event> events;
+		std::vector<char> read_buffer;
+		std::vector<int> watched;
+		std::vector<char> write_state;
+		std::vector<char> read_paused;
+
+		enum WriteState
+		{
+			WRITE_IDLE,
+			WRITE_BLOCKED,
+			WRITE_READY
+		};
+
+		enum AcceptResult
+		{
+			ACCEPT_DONE,
+			ACCEPT_OK,
+			ACCEPT_RETRY
+		};
+
+		void acceptClients(EventHandler& handler);
+		AcceptResult acceptClient(EventHandler& handler);
+		void readClient(EventHandler& handler, int client_fd);
+		void updateInterest(int client_fd);
+		bool isWatched(int fd) const;
+
+	public:
+		explicit EpollBackend(const ServerConfig& config);
+		virtual ~EpollBackend();
+
+		virtual const char* name() const;
+		virtual bool setup(int listen_fd);
+		virtual bool watch(int fd);
+
+		virtual bool addClient(int client_fd);
+		virtual bool send(int client_fd, OutputQueue& queue);
+		virtual void setReading(int client_fd, bool enabled);
+		virtual void close(int client_fd, OutputQueue& queue, bool flush);
+
+		virtual void retryAccept(EventHandler& handler);
+		virtual bool wait(EventHandler& handler, int timeout_ms);
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef EVENTBACKEND_HPP
+#define EVENTBACKEND_HPP
+
+#include <cstddef>
+#include <OutputQueue.hpp>
+#include <ServerConfig.hpp>
+
+// Receives what an EventBackend observed. Implemented by Reactor.
+class EventHandler
+{
+	public:
+		virtual ~EventHandler() {}
+
+		virtual void onAccept(int client_fd) = 0;
+		virtual void onAcceptBatch(int count) = 0;
+		virtual void onData(int client_fd, const char* data, size_t length) = 0;
+		// error is 0 when the peer closed the connection.
+		virtual void onHangup(int client_fd, int error) = 0;
+		virtual void onWritable(int client_fd) = 0;
+		virtual void onWatch(int fd) = 0;
+		// Accepting ran out of descriptors; retryAccept should be called shortly.
+		virtual void onAcceptStalled() = 0;
+};
+
+// The I/O mechanism under a Reactor: accepting, reading, writing and waiting.
+class EventBackend
+{
+	public:
+		virtual ~EventBackend() {}
+
+		virtual const char* name() const = 0;
+		virtual bool setup(int listen_fd) = 0;
+		// Reports readability of an auxiliary descriptor (eventfd, timerfd...) through onWatch.
+		virtual bool watch(int fd) = 0;
+
+		virtual bool addClient(int client_fd) = 0;
+		// Makes progress on sending queue; returns false on a fatal socket error.
+		virtual bool send(int client_fd, OutputQueue& queue) = 0;
+		// Stops or restarts reading a client; data already in flight may still be delivered.
+		virtual void setReading(int client_fd, bool enabled) = 0;
+		// Flushes what it can if requested, then closes the socket.
+		virtual void close(int client_fd, OutputQueue& queue, bool flush) = 0;
+
+		// Accepts again after onAcceptStalled, whether or not the listen socket signalled.
+		virtual void retryAccept(EventHandler& handler) = 0;
+
+		// Waits up to timeout_ms (-1: no limit) and dispatches events. Returns false on a fatal error.
+		virtual bool wait(EventHandler& handler, int timeout_ms) = 0;
+};
+
+EventBackend* createEventBackend(const ServerConfig& config, int listen_fd);
+
+#endif
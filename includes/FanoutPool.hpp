@@ -0,0 +1,66 @@
+#ifndef FANOUTPOOL_HPP
+#define FANOUTPOOL_HPP
+
+#include <cstddef>
+#include <vector>
+#include <pthread.h>
+
+// Worker threads that split one loop over a large range with the calling
+// thread. run() hands each worker a slice, runs slice 0 itself and returns
+// once every slice is done. Reactors share one pool: a run() that finds it
+// busy returns false at once, and the caller walks the range itself.
+class FanoutPool
+{
+	public:
+		class Task
+		{
+			public:
+				virtual ~Task() {}
+
+				// Handles [begin, end); slice 0 runs on the caller's thread.
+				virtual void runSlice(size_t slice, size_t begin, size_t end) = 0;
+		};
+
+	private:
+		struct Worker
+		{
+			FanoutPool* pool;
+			size_t slice;
+			pthread_t thread;
+		};
+
+		std::vector<Worker> workers;
+		size_t started;
+		// Held by the thread whose loop the workers are running.
+		pthread_mutex_t busy;
+		pthread_mutex_t mutex;
+		pthread_cond_t work_ready;
+		pthread_cond_t work_done;
+		unsigned long generation;
+		size_t pending;
+		bool stopping;
+		Task* task;
+		size_t count;
+
+		static void* threadMain(void* arg);
+		void work(size_t slice);
+		void runSlice(Task& task, size_t slice) const;
+
+		FanoutPool(const FanoutPool&);
+		FanoutPool& operator=(const FanoutPool&);
+
+	public:
+		FanoutPool();
+		~FanoutPool();
+
+		bool start(size_t threads);
+		void stop();
+		bool isRunning() const;
+
+		// Workers plus the caller.
+		size_t sliceCount() const;
+		// False, without running anything, while another thread uses the pool.
+		bool run(Task& task, size_t count);
+};
+
+#endif
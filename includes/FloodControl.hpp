@@ -0,0 +1,47 @@
+#ifndef FLOODCONTROL_HPP
+#define FLOODCONTROL_HPP
+
+#include <cstddef>
+#include <ctime>
+#include <ServerConfig.hpp>
+
+// Token buckets of one connection: one for commands, weighted by cost, and one
+// for input bytes. Each bucket is kept as the amount spent, so a reset record
+// is a full bucket. Spending may overdraw a bucket, by at most one burst per
+// charge; the connection's next line then waits until the refill has covered
+// the overdraft.
+class FloodControl
+{
+	private:
+		double commands_spent;
+		double bytes_spent;
+		bool overdrawn;
+		struct timespec last_refill;
+		struct timespec throttled_since;
+
+		void refillTo(const ServerConfig& config, const struct timespec& now);
+
+	public:
+		FloodControl();
+
+		void reset();
+
+		void charge(const ServerConfig& config, unsigned int tokens, size_t bytes);
+		bool isOverdrawn() const;
+		// Refills for the time elapsed; true when neither bucket is overdrawn anymore.
+		bool refill(const ServerConfig& config);
+		// Milliseconds until refill() can succeed, at least 1.
+		int refillDelay(const ServerConfig& config) const;
+
+		void markThrottled();
+		// Milliseconds since markThrottled().
+		long throttledFor() const;
+};
+
+// Defined here so that the per-line check in the reactor is inlined.
+inline bool FloodControl::isOverdrawn() const
+{
+    return overdrawn;
+}
+
+#endif
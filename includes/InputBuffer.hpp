@@ -0,0 +1,46 @@
+#ifndef INPUTBUFFER_HPP
+#define INPUTBUFFER_HPP
+
+#include <string>
+#include <StringView.hpp>
+
+// Splits received bytes into IRC lines. Complete lines are returned as views into
+// the chunk being fed; only an unterminated tail is copied and kept between reads,
+// unless hold() is called to keep the unread lines for later.
+class InputBuffer
+{
+	private:
+		std::string partial;
+		std::string held;
+		bool partial_consumed;
+		bool discarding;
+		const char* cursor;
+		const char* limit;
+
+		static size_t maxLength(char first);
+
+	public:
+		enum Result
+		{
+			NONE,
+			LINE,
+			TOO_LONG
+		};
+
+		// 512 bytes per RFC 1459 including CRLF; tagged lines may add 8191 bytes of tags.
+		static const size_t MAX_LINE = 510;
+		static const size_t MAX_TAGS = 8191;
+
+		InputBuffer();
+		~InputBuffer();
+
+		// Appends to the held bytes if some are still unread.
+		void feed(const char* data, size_t length);
+		Result next(StringView& line);
+
+		// Copies the bytes not yet returned by next() so they outlive the fed chunk.
+		void hold();
+		bool hasUnread() const;
+};
+
+#endif
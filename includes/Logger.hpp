@@ -0,0 +1,112 @@
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <string>
+#include <cstddef>
+#include <ctime>
+#include <pthread.h>
+#include <StringView.hpp>
+
+enum LogLevel
+{
+	LOG_OFF,
+	LOG_ERROR,
+	LOG_INFO,
+	LOG_DEBUG,
+	LOG_TRACE
+};
+
+// Asynchronous logger. Every thread that logs gets its own single-producer ring
+// of fixed-size entries; a writer thread drains the rings and writes them in
+// batches, and sleeps on an eventfd that a producer signals when its ring goes
+// from empty to non-empty. A full ring drops the entry and counts it instead
+// of blocking.
+// Before start() and after stop(), entries are written directly to the output.
+class Logger
+{
+	public:
+		static const size_t LINE_MAX = 512;
+
+	private:
+		struct Entry
+		{
+			struct timespec time;
+			LogLevel level;
+			size_t length;
+			char text[LINE_MAX];
+		};
+
+		struct Ring
+		{
+			static const unsigned long SLOTS = 1024;
+
+			Entry entries[SLOTS];
+			unsigned long head;
+			unsigned long tail;
+			unsigned long dropped;
+			Ring* next;
+		};
+
+		static LogLevel level;
+		static int output_fd;
+		static bool running;
+		static pthread_t writer;
+		static int wake_fd;
+		static pthread_mutex_t rings_mutex;
+		static Ring* rings;
+		static unsigned long dropped_reported;
+		static __thread Ring* local_ring;
+
+		static Ring* localRing();
+		static void* writerMain(void* arg);
+		static void wakeWriter();
+		static bool drain(std::string& batch);
+		static void format(std::string& batch, const Entry& entry);
+		static void writeAll(const std::string& batch);
+
+	public:
+		static bool parseLevel(const std::string& name, LogLevel& out);
+
+		// Opens path for appending, or uses stderr when it is empty.
+		static bool start(LogLevel level, const std::string& path);
+		static void stop();
+
+		static bool enabled(LogLevel message_level);
+		static void write(LogLevel message_level, const char* text, size_t length);
+};
+
+inline bool Logger::enabled(LogLevel message_level)
+{
+    return message_level <= level;
+}
+
+// Builds one log entry in place; it is submitted when the line goes out of scope.
+// Does nothing when the level is disabled.
+class LogLine
+{
+	private:
+		LogLevel level;
+		bool active;
+		size_t length;
+		char buffer[Logger::LINE_MAX];
+
+		void append(const char* data, size_t size);
+		void appendNumber(unsigned long value, bool negative);
+
+		LogLine(const LogLine&);
+		LogLine& operator=(const LogLine&);
+
+	public:
+		explicit LogLine(LogLevel level);
+		~LogLine();
+
+		LogLine& operator<<(const char* text);
+		LogLine& operator<<(const std::string& text);
+		LogLine& operator<<(const StringView& text);
+		LogLine& operator<<(int value);
+		LogLine& operator<<(long value);
+		LogLine& operator<<(unsigned int value);
+		LogLine& operator<<(unsigned long value);
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef MESSAGE_HPP
+#define MESSAGE_HPP
+
+#include <cstddef>
+#include <StringView.hpp>
+
+// One IRC message: [@tags] [:prefix] command [params...] [:trailing].
+// Every part is a view into the parsed line, so parsing never allocates.
+class Message
+{
+	public:
+		static const size_t MAX_PARAMS = 15;
+
+	private:
+		StringView tags;
+		StringView prefix;
+		StringView command;
+		StringView params[MAX_PARAMS];
+		size_t param_count;
+		const char* end;
+
+	public:
+		Message();
+
+		// Returns false when the line holds no command.
+		bool parse(const StringView& line);
+
+		const StringView& getTags() const;
+		const StringView& getPrefix() const;
+		const StringView& getCommand() const;
+		size_t paramCount() const;
+		// Empty view when the parameter is absent.
+		const StringView& param(size_t index) const;
+		// Everything from parameter index to the end of the line, for free text
+		// sent without a leading ':'.
+		StringView textFrom(size_t index) const;
+};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <string>
+#include <vector>
+#include <ctime>
+
+// Process-wide metrics registry. Metrics are created once (get-or-create by
+// name and label) and never freed, so callers keep references to them; updates
+// are relaxed atomic adds that any thread can make without the state lock.
+class Metrics
+{
+	public:
+		enum Type
+		{
+			COUNTER,
+			GAUGE,
+			HISTOGRAM
+		};
+
+		class Metric
+		{
+			private:
+				std::string name;
+				std::string help;
+				std::string label;
+				Type type;
+
+			public:
+				Metric(const std::string& name, const std::string& help, const std::string& label, Type type);
+				virtual ~Metric();
+
+				const std::string& getName() const;
+				const std::string& getHelp() const;
+				const std::string& getLabel() const;
+				Type getType() const;
+
+				// Appends the Prometheus samples, or one human-readable line.
+				virtual void render(std::string& out) const = 0;
+				virtual void summarize(std::string& out) const = 0;
+		};
+
+		class Counter : public Metric
+		{
+			private:
+				unsigned long value;
+
+			public:
+				Counter(const std::string& name, const std::string& help, const std::string& label);
+
+				void add(unsigned long amount = 1);
+				unsigned long get() const;
+
+				virtual void render(std::string& out) const;
+				virtual void summarize(std::string& out) const;
+		};
+
+		class Gauge : public Metric
+		{
+			private:
+				long value;
+
+			public:
+				Gauge(const std::string& name, const std::string& help, const std::string& label);
+
+				void set(long amount);
+				void add(long amount);
+				long get() const;
+
+				virtual void render(std::string& out) const;
+				virtual void summarize(std::string& out) const;
+		};
+
+		// Fixed buckets from 1us to 10ms, observed in nanoseconds, exported in seconds.
+		class Histogram : public Metric
+		{
+			public:
+				static const size_t BUCKETS = 13;
+
+			private:
+				static const unsigned long bounds[BUCKETS];
+
+				unsigned long counts[BUCKETS + 1];
+				unsigned long sum;
+				unsigned long count;
+
+			public:
+				Histogram(const std::string& name, const std::string& help, const std::string& label);
+
+				void observe(unsigned long nanoseconds);
+				unsigned long getCount() const;
+				// Upper bound of the bucket holding the given quantile, in nanoseconds.
+				unsigned long quantile(double q) const;
+
+				virtual void render(std::string& out) const;
+				virtual void summarize(std::string& out) const;
+		};
+
+		// label is a full Prometheus label set such as command="JOIN", or empty.
+		static Counter& counter(const std::string& name, const std::string& help, const std::string& label = "");
+		static Gauge& gauge(const std::string& name, const std::string& help, const std::string& label = "");
+		static Histogram& histogram(const std::string& name, const std::string& help, const std::string& label = "");
+
+		static void renderPrometheus(std::string& out);
+		// One line per metric, for the STATS command.
+		static void summarize(std::vector<std::string>& lines);
+
+		static unsigned long elapsedNanoseconds(const struct timespec& start);
+		static time_t startTime();
+
+	private:
+		static Metric* find(const std::string& name, const std::string& label);
+		static Metric* add(Metric* metric);
+};
+
+#endif
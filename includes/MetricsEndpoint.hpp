@@ -0,0 +1,34 @@
+#ifndef METRICSENDPOINT_HPP
+#define METRICSENDPOINT_HPP
+
+#include <pthread.h>
+
+class Server;
+
+// Serves the metrics registry in the Prometheus text format on 127.0.0.1.
+// One thread handles scrapes one at a time with blocking sockets, so a slow
+// scraper can only delay other scrapers, never the event loops.
+class MetricsEndpoint
+{
+	private:
+		Server& server;
+		int listen_fd;
+		pthread_t thread;
+		bool thread_started;
+
+		static void* threadMain(void* arg);
+		void run();
+		void serve(int client_fd);
+
+		MetricsEndpoint(const MetricsEndpoint&);
+		MetricsEndpoint& operator=(const MetricsEndpoint&);
+
+	public:
+		explicit MetricsEndpoint(Server& server);
+		~MetricsEndpoint();
+
+		bool start(int port);
+		void stop();
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef NICKINDEX_HPP
+#define NICKINDEX_HPP
+
+#include <string>
+#include <vector>
+#include <tr1/unordered_map>
+#include <StringView.hpp>
+#include <CaseMapping.hpp>
+
+// Nicknames in use, interned behind integer ids and hashed by the folded
+// nickname each entry computes once when it is added. Users keep the id, and
+// the stored spelling is only read back to format replies. Entries are heap
+// records, so ids and names stay valid while others are added and removed;
+// the ids of removed nicknames are reused.
+class NickIndex
+{
+	public:
+		typedef unsigned int Id;
+		static const Id NONE = ~0u;
+
+	private:
+		struct Entry
+		{
+			std::string name;
+			// rfc1459 fold of name, which the key in ids points at.
+			std::string folded;
+			int fd;
+		};
+
+		// Lookups fold as they hash, so reactors holding only their share of
+		// the state lock can run them at the same time.
+		std::tr1::unordered_map<FoldedKey, Id, FoldedHash, FoldedEqual> ids;
+		std::vector<Entry*> slots;
+		std::vector<Id> free_ids;
+
+		NickIndex(const NickIndex&);
+		NickIndex& operator=(const NickIndex&);
+
+	public:
+		NickIndex();
+		~NickIndex();
+
+		// Case-insensitive lookup; NONE if no client uses nickname.
+		Id find(const StringView& nickname) const;
+		// The client holding id, or -1 for an id that is not in use.
+		int owner(Id id) const;
+		// The nickname as its owner spelled it; id must be in use.
+		const std::string& name(Id id) const;
+		// Interns nickname for client_fd, which must be free or already client_fd's.
+		Id add(const StringView& nickname, int client_fd);
+		// Only removes the entry if it still belongs to client_fd.
+		void remove(Id id, int client_fd);
+		void clear();
+
+		size_t size() const;
+};
+
+// Defined here so that resolving the id a user keeps costs no call.
+inline int NickIndex::owner(Id id) const
+{
+    return (id < slots.size() && slots[id]) ? slots[id]->fd : -1;
+}
+
+inline const std::string& NickIndex::name(Id id) const
+{
+    return slots[id]->name;
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef NUMERICTABLE_HPP
+#define NUMERICTABLE_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <StringView.hpp>
+#include <Reply.hpp>
+
+// Every numeric reply the server sends. Some codes have several texts, so the
+// enum names a template rather than a code.
+enum Numeric
+{
+	RPL_WELCOME,
+	RPL_YOURHOST,
+	RPL_CREATED,
+	RPL_MYINFO,
+	RPL_ISUPPORT,
+	RPL_STATSCOMMANDS,
+	RPL_ENDOFSTATS,
+	RPL_STATSUPTIME,
+	RPL_STATSDEBUG,
+	RPL_CHANNELMODEIS,
+	RPL_NOTOPIC,
+	RPL_TOPIC,
+	RPL_INVITING,
+	RPL_NAMREPLY,
+	RPL_ENDOFNAMES,
+	RPL_YOUREOPER,
+	ERR_NOSUCHNICK,
+	ERR_NOSUCHCHANNEL,
+	ERR_NOORIGIN,
+	ERR_INPUTTOOLONG,
+	ERR_UNKNOWNCOMMAND,
+	ERR_ERRONEUSNICKNAME,
+	ERR_NICKNAMEINUSE,
+	ERR_USERNOTINCHANNEL,
+	ERR_NOTONCHANNEL,
+	ERR_USERONCHANNEL,
+	ERR_NOTREGISTERED,
+	ERR_NEEDMOREPARAMS,
+	ERR_INVALIDLIMIT,
+	ERR_PASSWDMISMATCH,
+	ERR_PASSWDREQUIRED,
+	ERR_CHANNELISFULL,
+	ERR_INVITEONLYCHAN,
+	ERR_BADCHANNELKEY,
+	ERR_NOPRIVILEGES,
+	ERR_CHANOPRIVSNEEDED,
+	ERR_LASTCHANOP,
+	ERR_NOOPERHOST,
+	ERR_USERSDONTMATCH,
+	NUMERIC_COUNT
+};
+
+// The numeric reply templates, compiled once at startup. Each template becomes
+// ":<server> <code> " followed by literal segments separated by argument slots,
+// the first slot being the client's nick; the server and network names are
+// already substituted. Rendering sums the pieces, reserves the line once and
+// copies each piece once.
+class NumericTable
+{
+	private:
+		struct Template
+		{
+			// Every literal segment, back to back.
+			std::string text;
+			// End of each segment in text; a slot follows every segment but the last.
+			std::vector<size_t> ends;
+		};
+
+		Template templates[NUMERIC_COUNT];
+
+		void compile(Numeric numeric, const char* code, const char* text,
+					 const std::string& server_name, const std::string& network_name);
+
+	public:
+		// Arguments fill the slots after the client in order; missing ones are left empty.
+		static const size_t MAX_ARGS = 3;
+
+		NumericTable(const std::string& server_name, const std::string& network_name);
+
+		// Length of the rendered line, CRLF included.
+		size_t length(Numeric numeric, const StringView& client, const StringView* args, size_t count) const;
+		// Appends the rendered line to out.
+		void render(Reply& out, Numeric numeric, const StringView& client, const StringView* args, size_t count) const;
+};
+
+#endif
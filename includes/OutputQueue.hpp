@@ -0,0 +1,45 @@
+#ifndef OUTPUTQUEUE_HPP
+#define OUTPUTQUEUE_HPP
+
+#include <deque>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <SharedBuffer.hpp>
+
+// Pending outbound data of one connection, drained when the socket is writable.
+// Buffers are queued by reference and written with one gathered sendmsg per batch
+// (sendmsg rather than writev so MSG_NOSIGNAL applies). Replies meant for this
+// connection alone are copied instead, packed into the last buffer while the
+// queue is its only owner.
+class OutputQueue
+{
+	private:
+		std::deque<SharedBuffer> chunks;
+		size_t offset;
+		size_t pending;
+
+	public:
+		static const int MAX_IOV = 64;
+		// Smallest buffer started by append, so that a burst of replies shares one.
+		static const size_t APPEND_BLOCK = 1024;
+
+		OutputQueue();
+		~OutputQueue();
+
+		void push(const SharedBuffer& data);
+		void append(const char* data, size_t length);
+		bool empty() const;
+		size_t size() const;
+		void clear();
+
+		// Fills iov with the head of the queue, optionally keeping references to the
+		// buffers for writes that complete asynchronously. Returns the iovec count.
+		int prepare(struct iovec* iov, int max_iov, std::vector<SharedBuffer>* hold) const;
+		void consume(size_t bytes);
+
+		// Sends as much as the socket accepts. Returns false on a fatal socket error.
+		bool flush(int fd);
+};
+
+#endif
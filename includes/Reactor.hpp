@@ -0,0 +1,135 @@
+#ifndef REACTOR_HPP
+#define REACTOR_HPP
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <ConnectionTable.hpp>
+#include <SharedBuffer.hpp>
+#include <StringView.hpp>
+#include <ServerConfig.hpp>
+#include <EventBackend.hpp>
+#include <TimerWheel.hpp>
+#include <FanoutPool.hpp>
+#include <Channel.hpp>
+
+class Server;
+
+// One event loop thread: its own event backend, listening socket and connections.
+// Output for connections owned by another reactor is posted to that reactor's mailbox.
+class Reactor : public EventHandler, public FanoutPool::Task
+{
+	private:
+		struct MailboxItem
+		{
+			int fd;
+			unsigned long id;
+			SharedBuffer message;
+		};
+
+		// What one fan-out slice produced, merged by the reactor once all are done.
+		struct FanoutSlice
+		{
+			std::vector<int> dirty;
+			std::vector<int> overflow;
+			std::vector<std::vector<MailboxItem> > outbox;
+		};
+
+		Server& server;
+		const ServerConfig& config;
+		size_t index;
+		int listen_fd;
+		int wake_fd;
+		EventBackend* backend;
+		pthread_t thread;
+		bool thread_started;
+		// Whether the state lock this reactor holds is every share or only its own.
+		bool state_exclusive;
+
+		ConnectionTable& connections;
+		std::vector<int> pending_disconnects;
+		std::vector<int> dirty;
+		TimerWheel timers;
+		// Retries accepting after the process ran out of descriptors.
+		TimerWheel::Timer accept_timer;
+
+		pthread_mutex_t mailbox_mutex;
+		std::vector<MailboxItem> mailbox;
+		std::vector<std::vector<MailboxItem> > outbox;
+
+		std::vector<FanoutSlice> fanout_slices;
+		const std::vector<Channel::Member>* fanout_members;
+		const SharedBuffer* fanout_message;
+		int fanout_exclude;
+
+		unsigned long accept_wakeups;
+		unsigned long accepted_total;
+		int max_accept_batch;
+
+		static __thread Reactor* current_reactor;
+
+		void markClosing(Connection& conn);
+		// Schedules the write of newly queued output, or writes now if the queue is already too big.
+		void queued(Connection& conn);
+		void sendOutput(Connection& conn);
+		void flushOutput();
+		void processPendingDisconnects();
+		bool processInput(Connection& conn);
+		void throttle(Connection& conn);
+		void serviceThrottled(Connection& conn);
+		void disconnectFlooder(Connection& conn);
+		void runTimers();
+		void checkKeepalive(Connection& conn);
+		// Sends ERROR :Closing Link and disconnects with reason as the QUIT message.
+		void closeLink(Connection& conn, const std::string& reason);
+		void drainMailbox();
+		void flushOutbox();
+		void wake();
+
+		static void* threadMain(void* arg);
+
+	public:
+		Reactor(Server& server, const ServerConfig& config, size_t index, size_t reactor_count);
+		~Reactor();
+
+		static Reactor* current();
+
+		bool setup(bool reuse_port);
+		bool start();
+		void join();
+		void run();
+
+		size_t getIndex() const;
+
+		// Every share of the state lock, for anything that changes the shared state.
+		void lockState();
+		// This reactor's share alone: enough to read the shared state, so reactors
+		// running shared commands do not wait for each other.
+		void lockShare();
+		void unlockState();
+
+		void queueOutput(int client_fd, const SharedBuffer& message);
+		// Copies a reply built for this client alone, see OutputQueue::append.
+		void queueOutput(int client_fd, const StringView& message);
+		void post(Reactor& target, int client_fd, unsigned long id, const SharedBuffer& message);
+		void closeConnection(int client_fd);
+
+		// Queues message to every joined member but exclude_fd, splitting the
+		// members between the pool's workers and this thread; false, with nothing
+		// queued, if another reactor is using the pool.
+		bool fanOut(FanoutPool& pool, const std::vector<Channel::Member>& members,
+			const SharedBuffer& message, int exclude_fd);
+		virtual void runSlice(size_t slice, size_t begin, size_t end);
+
+		void printAcceptStats() const;
+
+		virtual void onAccept(int client_fd);
+		virtual void onAcceptBatch(int count);
+		virtual void onData(int client_fd, const char* data, size_t length);
+		virtual void onHangup(int client_fd, int error);
+		virtual void onWritable(int client_fd);
+		virtual void onWatch(int fd);
+		virtual void onAcceptStalled();
+};
+
+#endif
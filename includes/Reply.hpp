@@ -0,0 +1,96 @@
+#ifndef REPLY_HPP
+#define REPLY_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <Arena.hpp>
+#include <StringView.hpp>
+
+// Formats one or more IRC lines into an Arena, so building a reply performs no
+// heap allocation. The bytes stay valid until the arena is reset, which
+// Command::process does once the handler has queued them.
+class Reply
+{
+	private:
+		Arena* arena;
+		char* buffer;
+		size_t length;
+		size_t capacity;
+
+		void grow(size_t needed);
+
+	public:
+		explicit Reply(Arena& arena, size_t expected = 128);
+
+		// Makes room for size more bytes, so the appends that follow do not grow.
+		void reserve(size_t size);
+		Reply& add(const char* data, size_t size);
+		Reply& add(const char* text);
+		Reply& add(const StringView& text);
+		Reply& add(char c);
+		Reply& number(unsigned long value);
+		// A middle parameter: a space, then value.
+		Reply& param(const StringView& value);
+		// The last parameter: " :", then text.
+		Reply& trailing(const StringView& text);
+		Reply& trailing(const char* text);
+		// Terminates the current line with CRLF.
+		Reply& end();
+
+		const char* data() const;
+		size_t size() const;
+		StringView view() const;
+};
+
+// Defined here so that the appends of a reply compile down to copies.
+inline void Reply::reserve(size_t size)
+{
+    if (capacity - length < size)
+        grow(length + size);
+}
+
+inline Reply& Reply::add(const char* data, size_t size)
+{
+    if (capacity - length < size)
+        grow(length + size);
+    std::memcpy(buffer + length, data, size);
+    length += size;
+    return *this;
+}
+
+inline Reply& Reply::add(const char* text)
+{
+    return add(text, std::strlen(text));
+}
+
+inline Reply& Reply::add(const StringView& text)
+{
+    return add(text.data(), text.size());
+}
+
+inline Reply& Reply::add(char c)
+{
+    return add(&c, 1);
+}
+
+inline Reply& Reply::param(const StringView& value)
+{
+    return add(' ').add(value);
+}
+
+inline Reply& Reply::trailing(const StringView& text)
+{
+    return add(" :", 2).add(text);
+}
+
+inline Reply& Reply::trailing(const char* text)
+{
+    return add(" :", 2).add(text);
+}
+
+inline Reply& Reply::end()
+{
+    return add("\r\n", 2);
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef RESOLVER_HPP
+#define RESOLVER_HPP
+
+#include <string>
+#include <deque>
+#include <pthread.h>
+#include <sys/socket.h>
+
+class Server;
+
+// Reverse DNS off the event loops. A worker thread looks up peer addresses
+// through the system resolver and hands each confirmed hostname to the server,
+// which stores it in the user's record if the connection is still the same one
+// and has not registered yet.
+class Resolver
+{
+	private:
+		struct Request
+		{
+			int fd;
+			unsigned long id;
+			struct sockaddr_storage addr;
+			socklen_t addr_len;
+		};
+
+		Server& server;
+		pthread_t thread;
+		bool thread_started;
+		bool stopping;
+		pthread_mutex_t mutex;
+		pthread_cond_t ready;
+		std::deque<Request> requests;
+
+		static void* threadMain(void* arg);
+		void run();
+
+		Resolver(const Resolver&);
+		Resolver& operator=(const Resolver&);
+
+	public:
+		// RFC 1459 limit for the host part of a prefix.
+		static const size_t MAX_HOSTNAME = 63;
+
+		explicit Resolver(Server& server);
+		~Resolver();
+
+		bool start();
+		void stop();
+
+		void resolve(int client_fd, unsigned long id, const struct sockaddr_storage& addr, socklen_t addr_len);
+
+		static std::string numericHost(const struct sockaddr_storage& addr, socklen_t addr_len);
+		// Reverse lookup confirmed by a forward lookup; empty when either fails.
+		static std::string lookup(const struct sockaddr_storage& addr, socklen_t addr_len);
+};
+
+#endif
@@ -2,41 +2,91 @@
 #define SERVER_HPP
 
 #include <string>
-#include <map>
-#include <set>
+#include <vector>
 #include <signal.h>
+#include <pthread.h>
 #include <User.hpp>
+#include <ConnectionTable.hpp>
 #include <Channel.hpp>
+#include <ChannelTable.hpp>
 #include <Command.hpp>
+#include <NickIndex.hpp>
+#include <Resolver.hpp>
+#include <MetricsEndpoint.hpp>
+#include <FanoutPool.hpp>
+#include <ServerConfig.hpp>
+#include <SharedBuffer.hpp>
+#include <StringView.hpp>
+#include <NumericTable.hpp>
+
+class Reactor;
 
 class Server
 {
 	private:
-		int port;
-		std::string password;
-		int server_fd;
-		int epoll_fd;
-		static bool running;
-
-		std::map<int, std::string> client_buffers;
-		std::map<int, User> users;
-		std::map<std::string, Channel> channels;
-		Command* command_handler;
-
-		void setupSocket();
-		void handleNewConnection();
-		void handleClientData(int client_fd);
-		void processCommand(int client_fd, const std::string& line);
+		ServerConfig config;
+		NumericTable numerics;
+		static volatile sig_atomic_t running;
+		// Written by the signal handler so that every reactor wakes up to stop.
+		static int shutdown_fd;
+
+		ConnectionTable connections;
+		NickIndex nicks;
+		ChannelTable channels;
+		// One per reactor, so that each formats into an arena of its own.
+		std::vector<Command*> command_handlers;
+		Resolver resolver;
+		MetricsEndpoint metrics_endpoint;
+		FanoutPool fanout_pool;
+
+		std::vector<Reactor*> reactors;
+		// The state lock, split into one share per reactor: reading the shared
+		// state takes any one share, changing it takes all of them, in order.
+		std::vector<pthread_mutex_t> state_shares;
+		unsigned long next_connection_id;
 
 		static void handleSignal(int signal);
 
 	public:
-		Server(int port, const std::string& password);
+		explicit Server(const ServerConfig& config);
 		~Server();
 
+		static const size_t MAX_SENDQ = 1024 * 1024;
+
+		static bool isRunning();
+		static int getShutdownFd();
+
 		void run();
-		void disconnectClient(int client_fd);
+		void sendToClient(int client_fd, const std::string& message);
+		void sendToClient(int client_fd, const StringView& message);
+		void sendToClient(int client_fd, const SharedBuffer& message);
+		// reason is the QUIT message shown to the client's channels.
+		void disconnectClient(int client_fd, const std::string& reason = "Connection closed");
 		void cleanupResources();
+		const ServerConfig& getConfig() const;
+		const NumericTable& getNumerics() const;
+
+		// Reactor interface: everything below except getReactor requires the state
+		// lock; processCommand and rejectLongLine accept a share for a shared command.
+		void lockState();
+		void unlockState();
+		void lockShare(size_t index);
+		void unlockShare(size_t index);
+		Reactor& getReactor(size_t index);
+		ConnectionTable& getConnections();
+		// Returns the connection id, or 0 if the table has no slot for client_fd.
+		unsigned long registerClient(int client_fd, Reactor* reactor);
+		// True when the command on line only reads the shared state.
+		bool isSharedCommand(const StringView& line) const;
+		void processCommand(int client_fd, const StringView& line);
+		void rejectLongLine(int client_fd);
+		// Applies a finished reverse lookup unless the fd now belongs to another connection.
+		void updateHostname(int client_fd, unsigned long id, const std::string& hostname);
+		// Broadcasts to a channel at or above the fan-out threshold through the
+		// worker pool; false when the caller should walk the members itself.
+		bool fanOut(const Channel& channel, const SharedBuffer& message, int exclude_fd);
+		// Sets the gauges that are cheaper to compute on demand than to keep current.
+		void refreshMetrics();
 };
 
 #endif
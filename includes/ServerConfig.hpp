@@ -0,0 +1,48 @@
+#ifndef SERVERCONFIG_HPP
+#define SERVERCONFIG_HPP
+
+#include <string>
+#include <Logger.hpp>
+
+struct ServerConfig
+{
+	int port;
+	std::string password;
+
+	int backlog;
+	int max_events;
+	bool accept_batch;
+	int threads;
+	int read_size;
+	std::string io_backend;
+	bool resolve_hosts;
+	LogLevel log_level;
+	std::string log_file;
+	std::string oper_name;
+	std::string oper_password;
+	int metrics_port;
+	// Flood control; a command rate of 0 disables it.
+	int flood_command_rate;
+	int flood_command_burst;
+	int flood_byte_rate;
+	int flood_byte_burst;
+	int flood_timeout;
+	// Keepalive, in seconds.
+	int ping_interval;
+	int ping_timeout;
+	int registration_timeout;
+	// Channels with at least fanout_threshold members are broadcast by
+	// fanout_threads workers along with the reactor; 0 threads disables it.
+	int fanout_threads;
+	int fanout_threshold;
+	// Prefix of the server's own messages, and the network named in 001 and 005.
+	std::string server_name;
+	std::string network_name;
+
+	ServerConfig();
+};
+
+bool parseServerConfig(int argc, char **argv, ServerConfig& config);
+void printServerUsage(const char *program);
+
+#endif
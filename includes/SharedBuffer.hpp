@@ -0,0 +1,43 @@
+#ifndef SHAREDBUFFER_HPP
+#define SHAREDBUFFER_HPP
+
+#include <string>
+#include <cstddef>
+
+// Reference-counted byte buffer, immutable once shared. A formatted line is
+// serialized once and the same block is queued to every recipient, possibly on
+// other threads. A buffer created with spare capacity can be appended to while
+// its creator holds the only reference.
+class SharedBuffer
+{
+	private:
+		struct Block
+		{
+			int refs;
+			size_t length;
+			size_t capacity;
+			char data[1];
+		};
+
+		Block* block;
+
+		void assign(const char* data, size_t length, size_t capacity);
+		void release();
+
+	public:
+		SharedBuffer();
+		explicit SharedBuffer(const std::string& data);
+		SharedBuffer(const char* data, size_t length);
+		SharedBuffer(const char* data, size_t length, size_t capacity);
+		SharedBuffer(const SharedBuffer& other);
+		SharedBuffer& operator=(const SharedBuffer& other);
+		~SharedBuffer();
+
+		const char* data() const;
+		size_t size() const;
+		bool empty() const;
+		// Copies data after the current bytes; false if the buffer is shared or full.
+		bool append(const char* data, size_t length);
+};
+
+#endif
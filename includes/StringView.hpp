@@ -0,0 +1,54 @@
+#ifndef STRINGVIEW_HPP
+#define STRINGVIEW_HPP
+
+#include <string>
+#include <cstddef>
+
+// Non-owning view over bytes owned by someone else (an input buffer, a std::string).
+class StringView
+{
+	private:
+		const char* ptr;
+		size_t len;
+
+	public:
+		StringView();
+		StringView(const char* data, size_t length);
+		StringView(const std::string& str);
+
+		const char* data() const;
+		size_t size() const;
+		bool empty() const;
+		char operator[](size_t index) const;
+
+		std::string str() const;
+};
+
+// Defined here so that parsing loops can inline them.
+inline StringView::StringView() : ptr(""), len(0) {}
+
+inline StringView::StringView(const char* data, size_t length) : ptr(data), len(length) {}
+
+inline StringView::StringView(const std::string& str) : ptr(str.data()), len(str.length()) {}
+
+inline const char* StringView::data() const
+{
+    return ptr;
+}
+
+inline size_t StringView::size() const
+{
+    return len;
+}
+
+inline bool StringView::empty() const
+{
+    return len == 0;
+}
+
+inline char StringView::operator[](size_t index) const
+{
+    return ptr[index];
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef TIMERWHEEL_HPP
+#define TIMERWHEEL_HPP
+
+#include <cstddef>
+#include <ctime>
+#include <stdint.h>
+
+// Hierarchical timing wheel of one reactor. Level n has SLOTS slots of
+// SLOTS^n ticks each; a timer goes in the lowest level whose span covers its
+// delay and moves down a level each time its slot comes round. Timers are
+// intrusive list nodes embedded in their owner, so scheduling and cancelling
+// are O(1) and allocate nothing. A timerfd is kept armed for the next tick
+// that has work, so an idle wheel causes no wakeups.
+class TimerWheel
+{
+	public:
+		static const long TICK_MS = 10;
+
+		struct Timer
+		{
+			Timer* prev;
+			Timer* next;
+			unsigned long expires;
+			unsigned int bucket;
+			int fd;
+
+			Timer();
+			bool isPending() const;
+		};
+
+	private:
+		static const unsigned int SLOT_BITS = 6;
+		static const unsigned int SLOTS = 1 << SLOT_BITS;
+		static const unsigned int LEVELS = 4;
+		static const unsigned int EXPIRED = LEVELS * SLOTS;
+
+		Timer buckets[LEVELS * SLOTS];
+		Timer expired;
+		uint64_t occupied[LEVELS];
+		unsigned long current;
+		unsigned long armed;
+		struct timespec origin;
+		int timer_fd;
+
+		void insert(Timer& timer);
+		void cascade(unsigned int level);
+		// First tick after current at which a slot expires or cascades; 0 if the wheel is empty.
+		unsigned long nextEvent() const;
+		void arm(unsigned long tick);
+
+		TimerWheel(const TimerWheel&);
+		TimerWheel& operator=(const TimerWheel&);
+
+	public:
+		TimerWheel();
+		~TimerWheel();
+
+		bool setup();
+		int getFd() const;
+
+		// Ticks since the wheel was created.
+		unsigned long now() const;
+
+		// (Re)schedules timer to fire delay_ms from now, rounded up to a tick.
+		void schedule(Timer& timer, long delay_ms);
+		void cancel(Timer& timer);
+
+		// Called when the timerfd fires: moves the timers that are due to the expired list.
+		void advance();
+		// Unlinks and returns the next expired timer, or NULL.
+		Timer* popExpired();
+		// Points the timerfd at the next tick with work, once the expired timers are handled.
+		void rearm();
+};
+
+// Defined here so that the checks on every schedule and cancel are inlined.
+inline bool TimerWheel::Timer::isPending() const
+{
+    return next != NULL;
+}
+
+#endif
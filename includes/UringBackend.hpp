@@ -0,0 +1,107 @@
+#ifndef URINGBACKEND_HPP
+#define URINGBACKEND_HPP
+
+#include <vector>
+#include <set>
+#include <sys/socket.h>
+#include <linux/io_uring.h>
+#include <EventBackend.hpp>
+
+// Completion-based backend on io_uring: multishot accept, multishot recv into a
+// provided buffer ring, and sendmsg submissions batched into one io_uring_enter.
+class UringBackend : public EventBackend
+{
+	private:
+		enum OpType
+		{
+			OP_SEND = 0,
+			OP_ACCEPT = 1,
+			OP_RECV = 2,
+			OP_WATCH = 3,
+			OP_CANCEL = 4
+		};
+
+		struct SendOp
+		{
+			int fd;
+			OutputQueue* queue;
+			struct msghdr msg;
+			struct iovec iov[OutputQueue::MAX_IOV];
+			std::vector<SharedBuffer> hold;
+		};
+
+		struct Slot
+		{
+			unsigned int generation;
+			bool active;
+			bool reading;
+			SendOp* send;
+		};
+
+		static const unsigned int RING_ENTRIES = 1024;
+		static const unsigned int BUFFER_COUNT = 256;
+
+		const ServerConfig& config;
+		int ring_fd;
+		int listen_fd;
+
+		void* ring_map;
+		size_t ring_map_size;
+		struct io_uring_sqe* sqes;
+		size_t sqes_size;
+		unsigned* sq_head;
+		unsigned* sq_tail;
+		unsigned* sq_array;
+		unsigned sq_mask;
+		unsigned sq_entries;
+		unsigned sq_local_tail;
+		unsigned* cq_head;
+		unsigned* cq_tail;
+		unsigned cq_mask;
+		struct io_uring_cqe* cqes;
+
+		struct io_uring_buf_ring* buf_ring;
+		size_t buf_ring_size;
+		char* buffers;
+		unsigned short buf_tail;
+
+		std::vector<Slot> slots;
+		std::set<SendOp*> in_flight;
+		bool accept_retry;
+		bool accept_stalled;
+
+		static unsigned long long encode(OpType type, unsigned int generation, int fd);
+
+		bool setupRing();
+		bool setupBuffers();
+		struct io_uring_sqe* getSqe();
+		bool enter(unsigned int wait_nr, int timeout_ms);
+
+		void armAccept();
+		void armRecv(int client_fd);
+		void armWatch(int fd);
+		void cancel(unsigned long long user_data);
+		void recycleBuffer(unsigned short bid);
+
+		void handleCompletion(EventHandler& handler, const struct io_uring_cqe& cqe, int& accepted);
+		void completeRecv(EventHandler& handler, const struct io_uring_cqe& cqe);
+		void completeSend(EventHandler& handler, SendOp* op, int result);
+
+	public:
+		explicit UringBackend(const ServerConfig& config);
+		virtual ~UringBackend();
+
+		virtual const char* name() const;
+		virtual bool setup(int listen_fd);
+		virtual bool watch(int fd);
+
+		virtual bool addClient(int client_fd);
+		virtual bool send(int client_fd, OutputQueue& queue);
+		virtual void setReading(int client_fd, bool enabled);
+		virtual void close(int client_fd, OutputQueue& queue, bool flush);
+
+		virtual void retryAccept(EventHandler& handler);
+		virtual bool wait(EventHandler& handler, int timeout_ms);
+};
+
+#endif
@@ -2,33 +2,58 @@
 #define USER_HPP
 
 #include <string>
+#include <vector>
+#include <StringView.hpp>
 
 class User
 {
 	private:
-		std::string nickname;
+		// NickIndex id, NONE until the first NICK.
+		unsigned int nick;
 		std::string username;
 		std::string realname;
+		std::string hostname;
+		// Starts with the nickname, the only copy of its spelling the user keeps.
+		std::string identity;
+		size_t nick_length;
 		bool authenticated;
 		bool password_verified;
+		bool irc_operator;
+		// ChannelTable ids, sorted.
+		std::vector<unsigned int> channels;
+
+		void updateIdentity(const StringView& nickname);
+		StringView identityNick() const;
 
 	public:
 		User();
 		~User();
 
-		const std::string& getNickname() const;
+		unsigned int getNick() const;
+		bool hasNickname() const;
 		const std::string& getUsername() const;
 		const std::string& getRealname() const;
+		const std::string& getHostname() const;
 		bool isAuthenticated() const;
 		bool isPasswordVerified() const;
+		bool isIrcOperator() const;
 
-		void setNickname(const std::string& nick);
+		// nickname is the spelling interned as nick_id, kept only in the identity.
+		void setNickname(unsigned int nick_id, const StringView& nickname);
 		void setUsername(const std::string& user);
 		void setRealname(const std::string& real);
+		void setHostname(const std::string& host);
 		void setAuthenticated(bool auth);
 		void setPasswordVerified(bool verified);
+		void setIrcOperator(bool oper);
+
+		// nick!~user@host, rebuilt only when one of its parts changes.
+		const std::string& getFullIdentity() const;
 
-		std::string getFullIdentity() const;
+		// Channels the user is a member of, kept in sync with Channel membership.
+		const std::vector<unsigned int>& getChannels() const;
+		void addChannel(unsigned int channel_id);
+		void removeChannel(unsigned int channel_id);
 };
 
 #endif
@@ -0,0 +1,89 @@
+#include <Arena.hpp>
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+
+Arena::Block* Arena::newBlock(size_t size, Block* next)
+{
+    Block* block = static_cast<Block*>(std::malloc(offsetof(Block, data) + size));
+    if (!block)
+        throw std::bad_alloc();
+
+    block->next = next;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+Arena::Arena() : head(newBlock(BLOCK_SIZE, NULL)), total(0), high_water(0) {}
+
+Arena::~Arena()
+{
+    releaseBlocks();
+}
+
+void Arena::releaseBlocks()
+{
+    while (head)
+	{
+        Block* next = head->next;
+        std::free(head);
+        head = next;
+    }
+}
+
+char* Arena::allocate(size_t size)
+{
+    // Keeps every allocation aligned for whatever is stored in it.
+    size_t aligned = (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+
+    if (head->size - head->used < aligned)
+	{
+        size_t block_size = head->size * 2;
+        if (block_size < aligned)
+            block_size = aligned;
+        head = newBlock(block_size, head);
+    }
+
+    char* ptr = head->data + head->used;
+    head->used += aligned;
+    total += aligned;
+    return ptr;
+}
+
+bool Arena::extend(char* ptr, size_t size, size_t new_size)
+{
+    size_t aligned = (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+    size_t new_aligned = (new_size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+
+    if (ptr + aligned != head->data + head->used)
+        return false;
+    if (head->size - head->used < new_aligned - aligned)
+        return false;
+
+    head->used += new_aligned - aligned;
+    total += new_aligned - aligned;
+    return true;
+}
+
+void Arena::reset()
+{
+    if (total > high_water)
+        high_water = total;
+
+    if (head->next == NULL)
+	{
+        head->used = 0;
+        total = 0;
+        return;
+    }
+
+    // The command overflowed the first block: replace the chain with one
+    // block that would have held it.
+    size_t size = high_water < MAX_RETAINED ? high_water : MAX_RETAINED;
+    if (size < BLOCK_SIZE)
+        size = BLOCK_SIZE;
+    releaseBlocks();
+    head = newBlock(size, NULL);
+    total = 0;
+}
@@ -0,0 +1,65 @@
+#include <CaseMapping.hpp>
+
+struct FoldTable
+{
+    char map[256];
+
+    FoldTable()
+    {
+        for (int c = 0; c < 256; ++c)
+            map[c] = static_cast<char>(c);
+        for (int c = 'A'; c <= 'Z'; ++c)
+            map[c] = static_cast<char>(c - 'A' + 'a');
+        map['['] = '{';
+        map[']'] = '}';
+        map['\\'] = '|';
+        map['~'] = '^';
+    }
+};
+
+static const FoldTable fold_table;
+
+char ircToLower(char c)
+{
+    return fold_table.map[static_cast<unsigned char>(c)];
+}
+
+std::string ircFold(const std::string& name)
+{
+    std::string folded;
+    ircFold(name, folded);
+    return folded;
+}
+
+void ircFold(const StringView& name, std::string& folded)
+{
+    folded.assign(name.data(), name.size());
+    for (std::string::iterator it = folded.begin(); it != folded.end(); ++it)
+        *it = ircToLower(*it);
+}
+
+FoldedKey::FoldedKey(const StringView& name) : data(name.data()), size(name.size()) {}
+
+// FNV-1a over the folded bytes.
+size_t FoldedHash::operator()(const FoldedKey& key) const
+{
+    size_t hash = 2166136261u;
+    for (size_t i = 0; i < key.size; ++i)
+	{
+        hash ^= static_cast<unsigned char>(ircToLower(key.data[i]));
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool FoldedEqual::operator()(const FoldedKey& a, const FoldedKey& b) const
+{
+    if (a.size != b.size)
+        return false;
+    for (size_t i = 0; i < a.size; ++i)
+	{
+        if (ircToLower(a.data[i]) != ircToLower(b.data[i]))
+            return false;
+    }
+    return true;
+}
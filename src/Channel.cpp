@@ -1,14 +1,17 @@
 #include <Channel.hpp>
-#include <sys/socket.h>
-#include <unistd.h>
+#include <Server.hpp>
+#include <CaseMapping.hpp>
 #include <sstream>
 #include <cstdlib>
 #include <cerrno>
+#include <algorithm>
 
-Channel::Channel() : inviteOnly(false), topicRestricted(true), hasUserLimit(false), hasKey(false), userLimit(0) {}
+Channel::Channel() : member_count(0), operator_count(0), inviteOnly(false), topicRestricted(true), hasUserLimit(false), hasKey(false), userLimit(0),
+    names_chunk(0), names_valid(false) {}
 
-Channel::Channel(const std::string& channelName) : name(channelName), topic("Welcome to " + channelName),
-    inviteOnly(false), topicRestricted(true), hasUserLimit(false), hasKey(false), userLimit(0) {}
+Channel::Channel(const std::string& channelName) : name(channelName), folded_name(ircFold(channelName)), topic("Welcome to " + channelName),
+    member_count(0), operator_count(0), inviteOnly(false), topicRestricted(true), hasUserLimit(false), hasKey(false), userLimit(0),
+    names_chunk(0), names_valid(false) {}
 
 Channel::~Channel() {}
 
@@ -17,24 +20,35 @@ const std::string& Channel::getName() const
     return name;
 }
 
+const std::string& Channel::getFoldedName() const
+{
+    return folded_name;
+}
+
 const std::string& Channel::getTopic() const
 {
     return topic;
 }
 
-const std::set<int>& Channel::getMembers() const
+const std::vector<Channel::Member>& Channel::getMembers() const
 {
     return members;
 }
 
-const std::set<int>& Channel::getOperators() const
+size_t Channel::getMemberCount() const
+{
+    return member_count;
+}
+
+size_t Channel::getOperatorCount() const
 {
-    return operators;
+    return operator_count;
 }
 
 void Channel::setName(const std::string& channelName)
 {
     name = channelName;
+    ircFold(name, folded_name);
 }
 
 void Channel::setTopic(const std::string& channelTopic)
@@ -42,61 +56,136 @@ void Channel::setTopic(const std::string& channelTopic)
     topic = channelTopic;
 }
 
+static bool memberBefore(const Channel::Member& member, int client_fd)
+{
+    return member.fd < client_fd;
+}
+
+std::vector<Channel::Member>::iterator Channel::locate(int client_fd)
+{
+    return std::lower_bound(members.begin(), members.end(), client_fd, memberBefore);
+}
+
+unsigned int Channel::flagsOf(int client_fd) const
+{
+    std::vector<Member>::const_iterator it = std::lower_bound(members.begin(), members.end(), client_fd, memberBefore);
+    if (it == members.end() || it->fd != client_fd)
+        return 0;
+    return it->flags;
+}
+
+// Sets a flag, creating the record if needed; false if it was already set.
+bool Channel::setFlag(int client_fd, unsigned int flag)
+{
+    std::vector<Member>::iterator it = locate(client_fd);
+    if (it == members.end() || it->fd != client_fd)
+	{
+        Member member;
+        member.fd = client_fd;
+        member.flags = flag;
+        members.insert(it, member);
+        return true;
+    }
+    if (it->flags & flag)
+        return false;
+    it->flags |= flag;
+    return true;
+}
+
+// Clears a flag, dropping the record once no flag is left; false if it was not set.
+bool Channel::clearFlag(int client_fd, unsigned int flag)
+{
+    std::vector<Member>::iterator it = locate(client_fd);
+    if (it == members.end() || it->fd != client_fd || !(it->flags & flag))
+        return false;
+
+    it->flags &= ~flag;
+    if (it->flags == 0)
+        members.erase(it);
+    return true;
+}
+
 bool Channel::addMember(int client_fd)
 {
-    return members.insert(client_fd).second;
+    if (!setFlag(client_fd, JOINED))
+        return false;
+    member_count++;
+    if (names_valid)
+        names_pending.push_back(client_fd);
+    return true;
 }
 
 bool Channel::removeMember(int client_fd)
 {
-    if (members.find(client_fd) == members.end())
+    if (!hasMember(client_fd))
         return false;
 
     removeOperator(client_fd);
-
-    return members.erase(client_fd) > 0;
+    clearFlag(client_fd, JOINED);
+    member_count--;
+    invalidateNames();
+    return true;
 }
 
 bool Channel::hasMember(int client_fd) const
 {
-    return members.find(client_fd) != members.end();
+    return (flagsOf(client_fd) & JOINED) != 0;
 }
 
 bool Channel::isEmpty() const
 {
-    return members.empty();
+    return member_count == 0;
+}
+
+int Channel::operatorSuccessor(int client_fd) const
+{
+    if (operator_count != 1 || !isOperator(client_fd) || member_count < 2)
+        return -1;
+
+    for (std::vector<Member>::const_iterator it = members.begin(); it != members.end(); ++it)
+	{
+        if ((it->flags & JOINED) && it->fd != client_fd)
+            return it->fd;
+    }
+    return -1;
 }
 
 bool Channel::addOperator(int client_fd)
 {
-    if (hasMember(client_fd))
-        return operators.insert(client_fd).second;
-    return false;
+    if (!hasMember(client_fd) || !setFlag(client_fd, OPERATOR))
+        return false;
+    operator_count++;
+    invalidateNames();
+    return true;
 }
 
 bool Channel::removeOperator(int client_fd)
 {
-    return operators.erase(client_fd) > 0;
+    if (!clearFlag(client_fd, OPERATOR))
+        return false;
+    operator_count--;
+    invalidateNames();
+    return true;
 }
 
 bool Channel::isOperator(int client_fd) const
 {
-    return operators.find(client_fd) != operators.end();
+    return (flagsOf(client_fd) & OPERATOR) != 0;
 }
 
 bool Channel::addInvite(int client_fd)
 {
-    return invited.insert(client_fd).second;
+    return setFlag(client_fd, INVITED);
 }
 
 bool Channel::removeInvite(int client_fd)
 {
-    return invited.erase(client_fd) > 0;
+    return clearFlag(client_fd, INVITED);
 }
 
 bool Channel::isInvited(int client_fd) const
 {
-    return invited.find(client_fd) != invited.end();
+    return (flagsOf(client_fd) & INVITED) != 0;
 }
 
 bool Channel::isInviteOnly() const
@@ -188,14 +277,75 @@ std::string Channel::getModeString() const
     return modes + params;
 }
 
-void Channel::broadcastMessage(const std::string& message, int excludeClient) const
+void Channel::appendName(const ConnectionTable& connections, const NickIndex& nicks,
+                         int client_fd, bool is_operator) const
+{
+    const std::string& nick = nicks.name(connections.user(client_fd).getNick());
+    size_t length = nick.size() + (is_operator ? 1 : 0);
+
+    if (names.empty() || names.back().size() + 1 + length > names_chunk)
+	{
+        names.push_back(std::string());
+        names.back().reserve(names_chunk);
+    }
+    else
+        names.back() += ' ';
+
+    if (is_operator)
+        names.back() += '@';
+    names.back() += nick;
+}
+
+const std::vector<std::string>& Channel::getNames(const ConnectionTable& connections, const NickIndex& nicks,
+                                                  size_t chunk_size) const
+{
+    if (!names_valid || chunk_size != names_chunk)
+	{
+        names.clear();
+        names_pending.clear();
+        names_chunk = chunk_size;
+        names_valid = true;
+
+        for (std::vector<Member>::const_iterator it = members.begin(); it != members.end(); ++it)
+		{
+            if (it->flags & JOINED)
+                appendName(connections, nicks, it->fd, (it->flags & OPERATOR) != 0);
+        }
+        return names;
+    }
+
+    for (size_t i = 0; i < names_pending.size(); ++i)
+	{
+        unsigned int flags = flagsOf(names_pending[i]);
+        if (flags & JOINED)
+            appendName(connections, nicks, names_pending[i], (flags & OPERATOR) != 0);
+    }
+    names_pending.clear();
+    return names;
+}
+
+void Channel::invalidateNames()
 {
-    for (std::set<int>::const_iterator it = members.begin(); it != members.end(); ++it)
+    names_valid = false;
+    names_pending.clear();
+}
+
+void Channel::broadcastMessage(Server& server, const std::string& message, int excludeClient) const
+{
+    broadcastMessage(server, SharedBuffer(message), excludeClient);
+}
+
+void Channel::broadcastMessage(Server& server, const SharedBuffer& message, int excludeClient) const
+{
+    if (server.fanOut(*this, message, excludeClient))
+        return;
+
+    for (std::vector<Member>::const_iterator it = members.begin(); it != members.end(); ++it)
 	{
-        if (*it != excludeClient)
+        if ((it->flags & JOINED) && it->fd != excludeClient)
 		{
-            if (*it > 0)
-                send(*it, message.c_str(), message.length(), MSG_NOSIGNAL);
+            if (it->fd > 0)
+                server.sendToClient(it->fd, message);
         }
     }
 }
@@ -0,0 +1,72 @@
+#include <ChannelTable.hpp>
+
+const ChannelTable::Id ChannelTable::NONE;
+
+ChannelTable::ChannelTable() {}
+
+ChannelTable::~ChannelTable()
+{
+    clear();
+}
+
+ChannelTable::Id ChannelTable::find(const StringView& name) const
+{
+    std::tr1::unordered_map<FoldedKey, Id, FoldedHash, FoldedEqual>::const_iterator it = ids.find(name);
+    if (it == ids.end())
+        return NONE;
+    return it->second;
+}
+
+ChannelTable::Id ChannelTable::create(const std::string& name)
+{
+    Id id = find(name);
+    if (id != NONE)
+        return id;
+
+    if (!free_ids.empty())
+	{
+        id = free_ids.back();
+        free_ids.pop_back();
+    }
+	else
+	{
+        id = static_cast<Id>(slots.size());
+        slots.push_back(NULL);
+    }
+
+    // The channel folds its name once; that copy is the key from now on.
+    slots[id] = new Channel(name);
+    ids[StringView(slots[id]->getFoldedName())] = id;
+    return id;
+}
+
+void ChannelTable::erase(Id id)
+{
+    Channel* channel = get(id);
+    if (!channel)
+        return;
+
+    ids.erase(StringView(channel->getFoldedName()));
+    delete channel;
+    slots[id] = NULL;
+    free_ids.push_back(id);
+}
+
+void ChannelTable::clear()
+{
+    for (size_t i = 0; i < slots.size(); ++i)
+        delete slots[i];
+    slots.clear();
+    free_ids.clear();
+    ids.clear();
+}
+
+size_t ChannelTable::size() const
+{
+    return ids.size();
+}
+
+ChannelTable::Id ChannelTable::bound() const
+{
+    return static_cast<Id>(slots.size());
+}
@@ -1,52 +1,171 @@
 #include <Command.hpp>
 #include <Server.hpp>
-#include <iostream>
-#include <algorithm>
-#include <sys/socket.h>
+#include <cstring>
 
-Command::Command(Server* server, std::map<int, User>& users, std::map<std::string, Channel>& channels, const std::string& password)
-    : server(server), users(users), channels(channels), password(password) {}
+Command::Command(Server* server, ConnectionTable& connections, NickIndex& nicks,
+                 ChannelTable& channels, const std::string& password)
+    : server(server), connections(connections), nicks(nicks), channels(channels), password(password)
+{
+    for (size_t i = 0; i < ROUTE_SLOTS; ++i)
+	{
+        routes[i].verb = NULL;
+        routes[i].length = 0;
+        routes[i].handler = NULL;
+        routes[i].cost = COST_DEFAULT;
+        routes[i].shared = false;
+        routes[i].latency = NULL;
+        routes[i].bytes = NULL;
+    }
+
+    addRoute("PASS", &Command::handlePass, COST_DEFAULT);
+    addRoute("NICK", &Command::handleNick, COST_DEFAULT);
+    addRoute("USER", &Command::handleUser, COST_DEFAULT);
+    addRoute("JOIN", &Command::handleJoin, COST_HEAVY);
+    addRoute("PRIVMSG", &Command::handlePrivmsg, COST_DEFAULT, true);
+    addRoute("PART", &Command::handlePart, COST_DEFAULT);
+    addRoute("QUIT", &Command::handleQuit, COST_DEFAULT);
+    addRoute("KICK", &Command::handleKick, COST_DEFAULT);
+    addRoute("INVITE", &Command::handleInvite, COST_DEFAULT);
+    addRoute("TOPIC", &Command::handleTopic, COST_DEFAULT);
+    addRoute("MODE", &Command::handleMode, COST_DEFAULT);
+    addRoute("OPER", &Command::handleOper, COST_HEAVY);
+    addRoute("STATS", &Command::handleStats, COST_HEAVY);
+    addRoute("PING", &Command::handlePing, COST_DEFAULT, true);
+    addRoute("PONG", &Command::handlePong, COST_DEFAULT, true);
+    addRoute("NAMES", &Command::handleNames, COST_HEAVY);
+}
 
 Command::~Command() {}
 
-void Command::process(int client_fd, const std::string& line)
-{
-    std::istringstream iss(line);
-    std::string command;
-    iss >> command;
-
-    std::transform(command.begin(), command.end(), command.begin(), ::toupper);
-
-    if (command == "PASS")
-        handlePass(client_fd, iss);
-    else if (command == "NICK")
-        handleNick(client_fd, iss);
-    else if (command == "USER")
-        handleUser(client_fd, line);
-    else if (command == "JOIN")
-        handleJoin(client_fd, iss);
-    else if (command == "PRIVMSG")
-        handlePrivmsg(client_fd, iss);
-    else if (command == "PART")
-        handlePart(client_fd, line);
-    else if (command == "QUIT")
+static Metrics::Counter& unknown_metric = Metrics::counter("irc_unknown_commands_total", "Lines with an unknown command.");
+
+static char upper(char c)
+{
+    return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+size_t Command::hashVerb(const char* verb, size_t length)
+{
+    size_t hash = length;
+    for (size_t i = 0; i < length; ++i)
+        hash = hash * 31 + static_cast<unsigned char>(upper(verb[i]));
+    return hash & (ROUTE_SLOTS - 1);
+}
+
+void Command::addRoute(const char* verb, Handler handler, unsigned int cost, bool shared)
+{
+    size_t length = std::strlen(verb);
+    size_t slot = hashVerb(verb, length);
+    while (routes[slot].verb != NULL)
+        slot = (slot + 1) & (ROUTE_SLOTS - 1);
+
+    routes[slot].verb = verb;
+    routes[slot].length = length;
+    routes[slot].handler = handler;
+    routes[slot].cost = cost;
+    routes[slot].shared = shared;
+
+    std::string label = std::string("command=\"") + verb + "\"";
+    routes[slot].latency = &Metrics::histogram("irc_command_duration_seconds", "Time spent handling each command.", label);
+    routes[slot].bytes = &Metrics::counter("irc_command_bytes_total", "Bytes of input lines per command.", label);
+}
+
+const Command::Route* Command::findRoute(const StringView& verb) const
+{
+    size_t slot = hashVerb(verb.data(), verb.size());
+    for (; routes[slot].verb != NULL; slot = (slot + 1) & (ROUTE_SLOTS - 1))
 	{
-        if (users.find(client_fd) != users.end())
-            handleQuit(client_fd, line);
-	}
-    else if (command == "KICK")
-        handleKick(client_fd, line);
-    else if (command == "INVITE")
-        handleInvite(client_fd, line);
-    else if (command == "TOPIC")
-        handleTopic(client_fd, line);
-    else if (command == "MODE")
-        handleMode(client_fd, line);
-    else
+        if (routes[slot].length != verb.size())
+            continue;
+
+        size_t i = 0;
+        while (i < verb.size() && upper(verb[i]) == routes[slot].verb[i])
+            ++i;
+        if (i == verb.size())
+            return &routes[slot];
+    }
+    return NULL;
+}
+
+Command::Handler Command::findHandler(const StringView& verb) const
+{
+    const Route* route = findRoute(verb);
+    return route ? route->handler : NULL;
+}
+
+const std::string& Command::nickOf(int client_fd) const
+{
+    return nicks.name(connections.user(client_fd).getNick());
+}
+
+bool Command::isShared(const StringView& line) const
+{
+    Message msg;
+    if (!msg.parse(line))
+        return true;
+
+    const Route* route = findRoute(msg.getCommand());
+    return !route || route->shared;
+}
+
+void Command::charge(int client_fd, unsigned int tokens, size_t bytes)
+{
+    Connection* conn = connections.find(client_fd);
+    if (conn)
+        conn->flood.charge(server->getConfig(), tokens, bytes);
+}
+
+void Command::appendNumeric(Reply& out, int client_fd, Numeric numeric, const StringView& first,
+                            const StringView& second, const StringView& third)
+{
+    const User& user = connections.user(client_fd);
+    StringView client = user.isAuthenticated() ? StringView(nicks.name(user.getNick())) : StringView("*", 1);
+    StringView args[NumericTable::MAX_ARGS] = { first, second, third };
+    server->getNumerics().render(out, numeric, client, args, NumericTable::MAX_ARGS);
+}
+
+void Command::reply(int client_fd, Numeric numeric, const StringView& first,
+                    const StringView& second, const StringView& third)
+{
+    Reply out(arena, 0);
+    appendNumeric(out, client_fd, numeric, first, second, third);
+    server->sendToClient(client_fd, out.view());
+}
+
+void Command::process(int client_fd, const StringView& view)
+{
+    Message msg;
+    if (!msg.parse(view))
 	{
-        std::string error = ":ircserv 421 " +
-                           (users[client_fd].isAuthenticated() ? users[client_fd].getNickname() : std::string("*")) +
-                           " " + command + " :Unknown command\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        charge(client_fd, COST_DEFAULT, view.size());
+        return;
+    }
+
+    const Route* route = findRoute(msg.getCommand());
+    charge(client_fd, route ? route->cost : COST_DEFAULT, view.size());
+    if (route)
+	{
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        (this->*route->handler)(client_fd, msg);
+        arena.reset();
+
+        route->latency->observe(Metrics::elapsedNanoseconds(start));
+        route->bytes->add(view.size());
+        return;
     }
+
+    unknown_metric.add();
+
+    reply(client_fd, ERR_UNKNOWNCOMMAND, msg.getCommand());
+    arena.reset();
+}
+
+void Command::replyInputTooLong(int client_fd)
+{
+    charge(client_fd, COST_DEFAULT, InputBuffer::MAX_LINE);
+
+    reply(client_fd, ERR_INPUTTOOLONG);
+    arena.reset();
 }
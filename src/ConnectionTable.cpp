@@ -0,0 +1,92 @@
+#include <ConnectionTable.hpp>
+#include <sys/resource.h>
+
+// The fd index is sized once from the descriptor limit so it never reallocates
+// while a reactor reads its own records without the state lock.
+static size_t descriptorLimit()
+{
+    const size_t max_fds = 1 << 20;
+    struct rlimit limit;
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) < 0 || limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur > max_fds)
+        return max_fds;
+    return static_cast<size_t>(limit.rlim_cur);
+}
+
+ConnectionTable::ConnectionTable()
+    : slot_by_fd(descriptorLimit(), -1), pages(slot_by_fd.size() / PAGE_SIZE + 1, NULL),
+      slot_count(0), free_head(-1), live(0)
+{
+}
+
+ConnectionTable::~ConnectionTable()
+{
+    for (size_t i = 0; i < pages.size(); ++i)
+        delete[] pages[i];
+}
+
+Connection* ConnectionTable::add(int fd, Reactor* reactor, unsigned long id)
+{
+    if (fd < 0 || static_cast<size_t>(fd) >= slot_by_fd.size())
+        return NULL;
+
+    int index = free_head;
+    if (index >= 0)
+        free_head = slot(index).next_free;
+    else
+	{
+        index = static_cast<int>(slot_count++);
+        if (!pages[index / PAGE_SIZE])
+            pages[index / PAGE_SIZE] = new Connection[PAGE_SIZE];
+    }
+
+    Connection& conn = slot(index);
+    conn.fd = fd;
+    conn.id = id;
+    conn.flags = Connection::IN_USE;
+    conn.next_free = -1;
+    conn.reactor = reactor;
+    conn.flood.reset();
+    conn.last_activity = 0;
+    conn.keepalive.fd = fd;
+    conn.flood_timer.fd = fd;
+
+    slot_by_fd[fd] = index;
+    live++;
+    return &conn;
+}
+
+void ConnectionTable::release(int fd)
+{
+    Connection* conn = find(fd);
+    if (!conn)
+        return;
+
+    int index = slot_by_fd[fd];
+    conn->fd = -1;
+    conn->flags = 0;
+    conn->reactor = NULL;
+    conn->user = User();
+    conn->input = InputBuffer();
+    conn->output.clear();
+    conn->next_free = free_head;
+
+    free_head = index;
+    slot_by_fd[fd] = -1;
+    live--;
+}
+
+size_t ConnectionTable::size() const
+{
+    return live;
+}
+
+void ConnectionTable::listFds(std::vector<int>& fds) const
+{
+    for (size_t i = 0; i < slot_count; ++i)
+	{
+        const Connection& conn = slot(static_cast<int>(i));
+        if (conn.flags & Connection::IN_USE)
+            fds.push_back(conn.fd);
+    }
+}
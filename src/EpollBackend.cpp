@@ -0,0 +1,252 @@
+#include <EpollBackend.hpp>
+#include <Logger.hpp>
+#include <iostream>
+#include <algorithm>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+
+EpollBackend::EpollBackend(const ServerConfig& config)
+    : config(config), epoll_fd(-1), listen_fd(-1), accept_pending(false),
+      events(config.max_events), read_buffer(config.read_size) {}
+
+EpollBackend::~EpollBackend()
+{
+    if (epoll_fd >= 0)
+        ::close(epoll_fd);
+}
+
+const char* EpollBackend::name() const
+{
+    return "epoll";
+}
+
+bool EpollBackend::setup(int fd)
+{
+    listen_fd = fd;
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+	{
+        std::cerr << "Error creating epoll instance: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct epoll_event event;
+    event.events = config.accept_batch ? (EPOLLIN | EPOLLET) : EPOLLIN;
+    event.data.fd = listen_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) < 0)
+	{
+        std::cerr << "Error adding server socket to epoll: " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool EpollBackend::watch(int fd)
+{
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+	{
+        std::cerr << "Error adding descriptor to epoll: " << strerror(errno) << std::endl;
+        return false;
+    }
+    watched.push_back(fd);
+    return true;
+}
+
+bool EpollBackend::isWatched(int fd) const
+{
+    return std::find(watched.begin(), watched.end(), fd) != watched.end();
+}
+
+bool EpollBackend::addClient(int client_fd)
+{
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = client_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &event) < 0)
+	{
+        std::cerr << "Error adding client socket to epoll: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    if (static_cast<size_t>(client_fd) >= write_state.size())
+	{
+        write_state.resize(client_fd + 1, WRITE_IDLE);
+        read_paused.resize(client_fd + 1, false);
+    }
+    write_state[client_fd] = WRITE_IDLE;
+    read_paused[client_fd] = false;
+    return true;
+}
+
+void EpollBackend::updateInterest(int client_fd)
+{
+    struct epoll_event event;
+    event.events = 0;
+    if (!read_paused[client_fd])
+        event.events |= EPOLLIN;
+    if (write_state[client_fd] != WRITE_IDLE)
+        event.events |= EPOLLOUT;
+    event.data.fd = client_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client_fd, &event);
+}
+
+void EpollBackend::setReading(int client_fd, bool enabled)
+{
+    if (read_paused[client_fd] == !enabled)
+        return;
+    read_paused[client_fd] = !enabled;
+    updateInterest(client_fd);
+}
+
+bool EpollBackend::send(int client_fd, OutputQueue& queue)
+{
+    char& state = write_state[client_fd];
+
+    // Still waiting for EPOLLOUT: the socket buffer is known to be full.
+    if (state == WRITE_BLOCKED && !queue.empty())
+        return true;
+
+    if (!queue.flush(client_fd))
+        return false;
+
+    if (!queue.empty())
+	{
+        bool was_idle = (state == WRITE_IDLE);
+        state = WRITE_BLOCKED;
+        if (was_idle)
+            updateInterest(client_fd);
+    }
+    else if (state != WRITE_IDLE)
+	{
+        state = WRITE_IDLE;
+        updateInterest(client_fd);
+    }
+    return true;
+}
+
+void EpollBackend::close(int client_fd, OutputQueue& queue, bool flush)
+{
+    if (flush)
+        queue.flush(client_fd);
+
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client_fd, NULL);
+    ::close(client_fd);
+    write_state[client_fd] = WRITE_IDLE;
+    read_paused[client_fd] = false;
+}
+
+void EpollBackend::acceptClients(EventHandler& handler)
+{
+    int accepted = 0;
+    AcceptResult result;
+
+    // Interrupted or aborted accepts are retried without counting: the batch
+    // size only reports connections that were actually handed over.
+    do
+	{
+        result = acceptClient(handler);
+        if (result == ACCEPT_OK)
+            accepted++;
+    } while (result != ACCEPT_DONE && (config.accept_batch || result == ACCEPT_RETRY));
+
+    if (accepted > 0)
+        handler.onAcceptBatch(accepted);
+}
+
+EpollBackend::AcceptResult EpollBackend::acceptClient(EventHandler& handler)
+{
+    int client_fd;
+    struct sockaddr_in client_addr;
+    socklen_t addr_len = sizeof(client_addr);
+
+    client_fd = accept4(listen_fd, (struct sockaddr *)&client_addr, &addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (client_fd < 0)
+	{
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+		{
+            accept_pending = false;
+            return ACCEPT_DONE;
+        }
+        if (errno == EINTR || errno == ECONNABORTED)
+            return ACCEPT_RETRY;
+        if (errno == EMFILE || errno == ENFILE)
+		{
+            if (!accept_pending)
+                LogLine(LOG_ERROR) << "Error accepting connection: " << strerror(errno);
+            accept_pending = true;
+            handler.onAcceptStalled();
+            return ACCEPT_DONE;
+        }
+
+        LogLine(LOG_ERROR) << "Error accepting connection: " << strerror(errno);
+        return ACCEPT_DONE;
+    }
+
+    handler.onAccept(client_fd);
+    return ACCEPT_OK;
+}
+
+void EpollBackend::readClient(EventHandler& handler, int client_fd)
+{
+    ssize_t bytes_received = recv(client_fd, &read_buffer[0], read_buffer.size(), 0);
+
+    if (bytes_received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return;
+
+    if (bytes_received <= 0)
+        handler.onHangup(client_fd, bytes_received == 0 ? 0 : errno);
+    else
+        handler.onData(client_fd, &read_buffer[0], bytes_received);
+}
+
+bool EpollBackend::wait(EventHandler& handler, int timeout_ms)
+{
+    int n_events = epoll_wait(epoll_fd, &events[0], events.size(), timeout_ms);
+
+    if (n_events < 0)
+	{
+        if (errno == EINTR)
+            return true;
+
+        LogLine(LOG_ERROR) << "Error in epoll_wait: " << strerror(errno);
+        return false;
+    }
+
+    for (int i = 0; i < n_events; i++)
+	{
+        int fd = events[i].data.fd;
+
+        if (fd == listen_fd)
+            acceptClients(handler);
+        else if (isWatched(fd))
+            handler.onWatch(fd);
+        else
+		{
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                readClient(handler, fd);
+
+            if ((events[i].events & EPOLLOUT) && write_state[fd] == WRITE_BLOCKED)
+			{
+                write_state[fd] = WRITE_READY;
+                handler.onWritable(fd);
+            }
+        }
+    }
+
+    return true;
+}
+
+// The listen socket is edge-triggered, so connections left in the backlog by
+// EMFILE raise no new event; the reactor calls this from a timer instead.
+void EpollBackend::retryAccept(EventHandler& handler)
+{
+    if (accept_pending)
+        acceptClients(handler);
+}
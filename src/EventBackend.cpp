@@ -0,0 +1,24 @@
+#include <EventBackend.hpp>
+#include <EpollBackend.hpp>
+#include <UringBackend.hpp>
+#include <iostream>
+
+EventBackend* createEventBackend(const ServerConfig& config, int listen_fd)
+{
+    if (config.io_backend == "io_uring")
+	{
+        EventBackend* backend = new UringBackend(config);
+        if (backend->setup(listen_fd))
+            return backend;
+
+        delete backend;
+        std::cerr << "io_uring unavailable, falling back to epoll" << std::endl;
+    }
+
+    EventBackend* backend = new EpollBackend(config);
+    if (backend->setup(listen_fd))
+        return backend;
+
+    delete backend;
+    return NULL;
+}
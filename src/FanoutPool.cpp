@@ -0,0 +1,128 @@
+#include <FanoutPool.hpp>
+#include <iostream>
+
+FanoutPool::FanoutPool()
+    : started(0), generation(0), pending(0), stopping(false), task(NULL), count(0)
+{
+    pthread_mutex_init(&busy, NULL);
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&work_ready, NULL);
+    pthread_cond_init(&work_done, NULL);
+}
+
+FanoutPool::~FanoutPool()
+{
+    stop();
+    pthread_cond_destroy(&work_done);
+    pthread_cond_destroy(&work_ready);
+    pthread_mutex_destroy(&mutex);
+    pthread_mutex_destroy(&busy);
+}
+
+void* FanoutPool::threadMain(void* arg)
+{
+    Worker* worker = static_cast<Worker*>(arg);
+    worker->pool->work(worker->slice);
+    return NULL;
+}
+
+bool FanoutPool::start(size_t threads)
+{
+    // Sized up front: the threads keep pointers to their Worker.
+    workers.resize(threads);
+    stopping = false;
+
+    for (started = 0; started < threads; ++started)
+	{
+        workers[started].pool = this;
+        workers[started].slice = started + 1;
+        if (pthread_create(&workers[started].thread, NULL, threadMain, &workers[started]) != 0)
+		{
+            std::cerr << "Error creating fan-out thread" << std::endl;
+            stop();
+            return false;
+        }
+    }
+    return true;
+}
+
+void FanoutPool::stop()
+{
+    if (started == 0)
+        return;
+
+    pthread_mutex_lock(&mutex);
+    stopping = true;
+    pthread_cond_broadcast(&work_ready);
+    pthread_mutex_unlock(&mutex);
+
+    for (size_t i = 0; i < started; ++i)
+        pthread_join(workers[i].thread, NULL);
+    started = 0;
+    workers.clear();
+}
+
+bool FanoutPool::isRunning() const
+{
+    return started > 0;
+}
+
+size_t FanoutPool::sliceCount() const
+{
+    return started + 1;
+}
+
+void FanoutPool::runSlice(Task& task, size_t slice) const
+{
+    size_t slices = started + 1;
+    task.runSlice(slice, count * slice / slices, count * (slice + 1) / slices);
+}
+
+void FanoutPool::work(size_t slice)
+{
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&mutex);
+    while (true)
+	{
+        while (generation == seen && !stopping)
+            pthread_cond_wait(&work_ready, &mutex);
+        if (stopping)
+            break;
+
+        seen = generation;
+        Task* current = task;
+        pthread_mutex_unlock(&mutex);
+
+        runSlice(*current, slice);
+
+        pthread_mutex_lock(&mutex);
+        if (--pending == 0)
+            pthread_cond_signal(&work_done);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+bool FanoutPool::run(Task& task, size_t count)
+{
+    if (pthread_mutex_trylock(&busy) != 0)
+        return false;
+
+    pthread_mutex_lock(&mutex);
+    this->task = &task;
+    this->count = count;
+    pending = started;
+    generation++;
+    pthread_cond_broadcast(&work_ready);
+    pthread_mutex_unlock(&mutex);
+
+    runSlice(task, 0);
+
+    pthread_mutex_lock(&mutex);
+    while (pending > 0)
+        pthread_cond_wait(&work_done, &mutex);
+    pthread_mutex_unlock(&mutex);
+
+    pthread_mutex_unlock(&busy);
+    return true;
+}
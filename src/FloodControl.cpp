@@ -0,0 +1,82 @@
+#include <FloodControl.hpp>
+#include <cmath>
+#include <algorithm>
+
+// Millisecond resolution is plenty for budgets counted in commands per second.
+static struct timespec coarseNow()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    return now;
+}
+
+FloodControl::FloodControl()
+{
+    reset();
+}
+
+void FloodControl::reset()
+{
+    commands_spent = 0;
+    bytes_spent = 0;
+    overdrawn = false;
+    last_refill = coarseNow();
+    throttled_since = last_refill;
+}
+
+void FloodControl::refillTo(const ServerConfig& config, const struct timespec& now)
+{
+    double elapsed = (now.tv_sec - last_refill.tv_sec) + (now.tv_nsec - last_refill.tv_nsec) / 1e9;
+    last_refill = now;
+    if (elapsed <= 0)
+        return;
+
+    commands_spent = std::max(0.0, commands_spent - elapsed * config.flood_command_rate);
+    bytes_spent = std::max(0.0, bytes_spent - elapsed * config.flood_byte_rate);
+}
+
+void FloodControl::charge(const ServerConfig& config, unsigned int tokens, size_t bytes)
+{
+    if (config.flood_command_rate == 0)
+        return;
+
+    // One charge never costs more than a full bucket, so a single command to a
+    // huge channel overdraws by at most burst / rate seconds.
+    refillTo(config, coarseNow());
+    commands_spent += std::min(static_cast<double>(tokens), static_cast<double>(config.flood_command_burst));
+    bytes_spent += std::min(static_cast<double>(bytes), static_cast<double>(config.flood_byte_burst));
+    overdrawn = commands_spent > config.flood_command_burst || bytes_spent > config.flood_byte_burst;
+}
+
+bool FloodControl::refill(const ServerConfig& config)
+{
+    if (!overdrawn)
+        return true;
+
+    refillTo(config, coarseNow());
+    overdrawn = commands_spent > config.flood_command_burst || bytes_spent > config.flood_byte_burst;
+    return !overdrawn;
+}
+
+int FloodControl::refillDelay(const ServerConfig& config) const
+{
+    double seconds = 0;
+    if (commands_spent > config.flood_command_burst)
+        seconds = (commands_spent - config.flood_command_burst) / config.flood_command_rate;
+    if (bytes_spent > config.flood_byte_burst)
+        seconds = std::max(seconds, (bytes_spent - config.flood_byte_burst) / config.flood_byte_rate);
+
+    int delay = static_cast<int>(std::ceil(seconds * 1000));
+    return delay < 1 ? 1 : delay;
+}
+
+void FloodControl::markThrottled()
+{
+    throttled_since = coarseNow();
+}
+
+long FloodControl::throttledFor() const
+{
+    struct timespec now = coarseNow();
+    return (now.tv_sec - throttled_since.tv_sec) * 1000L + (now.tv_nsec - throttled_since.tv_nsec) / 1000000;
+}
@@ -0,0 +1,112 @@
+#include <InputBuffer.hpp>
+#include <cstring>
+
+InputBuffer::InputBuffer()
+    : partial_consumed(false), discarding(false), cursor(NULL), limit(NULL) {}
+
+InputBuffer::~InputBuffer() {}
+
+size_t InputBuffer::maxLength(char first)
+{
+    return (first == '@') ? MAX_TAGS + 1 + MAX_LINE : MAX_LINE;
+}
+
+void InputBuffer::feed(const char* data, size_t length)
+{
+    if (cursor < limit)
+	{
+        hold();
+        held.append(data, length);
+        cursor = held.data();
+        limit = cursor + held.size();
+        return;
+    }
+
+    cursor = data;
+    limit = data + length;
+}
+
+void InputBuffer::hold()
+{
+    if (cursor >= limit)
+        return;
+
+    if (cursor >= held.data() && cursor < held.data() + held.size())
+        held.erase(0, cursor - held.data());
+    else
+        held.assign(cursor, limit - cursor);
+
+    cursor = held.data();
+    limit = cursor + held.size();
+}
+
+bool InputBuffer::hasUnread() const
+{
+    return cursor < limit;
+}
+
+InputBuffer::Result InputBuffer::next(StringView& line)
+{
+    if (partial_consumed)
+	{
+        partial.clear();
+        partial_consumed = false;
+    }
+
+    while (cursor < limit)
+	{
+        const char* nl = static_cast<const char*>(std::memchr(cursor, '\n', limit - cursor));
+
+        if (discarding)
+		{
+            if (!nl)
+			{
+                cursor = limit;
+                return NONE;
+            }
+            cursor = nl + 1;
+            discarding = false;
+            continue;
+        }
+
+        if (!nl)
+		{
+            size_t rest = limit - cursor;
+            char first = partial.empty() ? *cursor : partial[0];
+
+            if (partial.size() + rest > maxLength(first) + 1)
+			{
+                partial.clear();
+                cursor = limit;
+                discarding = true;
+                return TOO_LONG;
+            }
+
+            partial.append(cursor, rest);
+            cursor = limit;
+            return NONE;
+        }
+
+        const char* begin = cursor;
+        size_t length = nl - cursor;
+        cursor = nl + 1;
+
+        if (!partial.empty())
+		{
+            partial.append(begin, length);
+            begin = partial.data();
+            length = partial.length();
+            partial_consumed = true;
+        }
+
+        if (length > 0 && begin[length - 1] == '\r')
+            length--;
+
+        if (length > 0 && length > maxLength(begin[0]))
+            return TOO_LONG;
+
+        line = StringView(begin, length);
+        return LINE;
+    }
+    return NONE;
+}
@@ -0,0 +1,351 @@
+#include <Logger.hpp>
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+LogLevel Logger::level = LOG_INFO;
+int Logger::output_fd = STDERR_FILENO;
+bool Logger::running = false;
+pthread_t Logger::writer;
+int Logger::wake_fd = -1;
+pthread_mutex_t Logger::rings_mutex = PTHREAD_MUTEX_INITIALIZER;
+Logger::Ring* Logger::rings = NULL;
+unsigned long Logger::dropped_reported = 0;
+__thread Logger::Ring* Logger::local_ring = NULL;
+
+static const char* levelName(LogLevel level)
+{
+    switch (level)
+	{
+        case LOG_ERROR: return "ERROR";
+        case LOG_INFO:  return "INFO ";
+        case LOG_DEBUG: return "DEBUG";
+        case LOG_TRACE: return "TRACE";
+        default:        return "     ";
+    }
+}
+
+bool Logger::parseLevel(const std::string& name, LogLevel& out)
+{
+    static const char* names[] = { "off", "error", "info", "debug", "trace" };
+
+    for (int i = LOG_OFF; i <= LOG_TRACE; ++i)
+	{
+        if (name == names[i])
+		{
+            out = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Logger::start(LogLevel new_level, const std::string& path)
+{
+    level = new_level;
+
+    if (!path.empty())
+	{
+        output_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (output_fd < 0)
+		{
+            std::cerr << "Error opening log file " << path << ": " << strerror(errno) << std::endl;
+            output_fd = STDERR_FILENO;
+            return false;
+        }
+    }
+
+    if (level == LOG_OFF)
+        return true;
+
+    // Kept open for the life of the process, so that a thread still logging
+    // while stop() runs never writes to a closed descriptor.
+    if (wake_fd < 0)
+        wake_fd = eventfd(0, EFD_CLOEXEC);
+    if (wake_fd < 0)
+	{
+        std::cerr << "Error creating log writer eventfd: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Set first, or a writer scheduled before the store would see the logger
+    // stopped and exit with nothing to drain.
+    __atomic_store_n(&running, true, __ATOMIC_RELEASE);
+    if (pthread_create(&writer, NULL, writerMain, NULL) != 0)
+	{
+        __atomic_store_n(&running, false, __ATOMIC_RELEASE);
+        std::cerr << "Error creating log writer thread" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Logger::stop()
+{
+    if (__atomic_load_n(&running, __ATOMIC_ACQUIRE))
+	{
+        __atomic_store_n(&running, false, __ATOMIC_RELEASE);
+        wakeWriter();
+        pthread_join(writer, NULL);
+    }
+
+    if (output_fd != STDERR_FILENO)
+	{
+        close(output_fd);
+        output_fd = STDERR_FILENO;
+    }
+}
+
+Logger::Ring* Logger::localRing()
+{
+    if (local_ring)
+        return local_ring;
+
+    Ring* ring = new Ring;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->dropped = 0;
+
+    pthread_mutex_lock(&rings_mutex);
+    ring->next = rings;
+    __atomic_store_n(&rings, ring, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&rings_mutex);
+
+    local_ring = ring;
+    return ring;
+}
+
+void Logger::write(LogLevel message_level, const char* text, size_t length)
+{
+    if (!enabled(message_level))
+        return;
+    if (length > LINE_MAX)
+        length = LINE_MAX;
+
+    Entry* entry;
+    Entry direct;
+    Ring* ring = NULL;
+
+    if (__atomic_load_n(&running, __ATOMIC_ACQUIRE))
+	{
+        ring = localRing();
+        unsigned long tail = ring->tail;
+        if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == Ring::SLOTS)
+		{
+            __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        entry = &ring->entries[tail % Ring::SLOTS];
+    }
+    else
+        entry = &direct;
+
+    clock_gettime(CLOCK_REALTIME_COARSE, &entry->time);
+    entry->level = message_level;
+    entry->length = length;
+    std::memcpy(entry->text, text, length);
+
+    if (ring)
+	{
+        // The writer only sleeps after finding every ring empty, so it needs a
+        // wakeup when this entry is the only one queued. Sequentially consistent,
+        // paired with drain, so that either side sees the other's update.
+        unsigned long tail = ring->tail;
+        __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) == tail)
+            wakeWriter();
+    }
+    else
+	{
+        std::string line;
+        format(line, direct);
+        writeAll(line);
+    }
+}
+
+void Logger::format(std::string& batch, const Entry& entry)
+{
+    char stamp[32];
+    struct tm parts;
+    localtime_r(&entry.time.tv_sec, &parts);
+    size_t used = strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &parts);
+
+    char millis[8];
+    millis[0] = '.';
+    long ms = entry.time.tv_nsec / 1000000;
+    millis[1] = static_cast<char>('0' + ms / 100);
+    millis[2] = static_cast<char>('0' + ms / 10 % 10);
+    millis[3] = static_cast<char>('0' + ms % 10);
+    millis[4] = ' ';
+
+    batch.append(stamp, used);
+    batch.append(millis, 5);
+    batch.append(levelName(entry.level));
+    batch.append(1, ' ');
+    batch.append(entry.text, entry.length);
+    batch.append(1, '\n');
+}
+
+void Logger::writeAll(const std::string& batch)
+{
+    size_t done = 0;
+    while (done < batch.size())
+	{
+        ssize_t written = ::write(output_fd, batch.data() + done, batch.size() - done);
+        if (written < 0)
+		{
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        done += written;
+    }
+}
+
+// Moves everything queued so far into batch; false when there was nothing.
+bool Logger::drain(std::string& batch)
+{
+    unsigned long dropped = 0;
+
+    for (Ring* ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring; ring = ring->next)
+	{
+        unsigned long head = ring->head;
+        unsigned long tail = __atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST);
+        for (; head != tail; ++head)
+            format(batch, ring->entries[head % Ring::SLOTS]);
+        __atomic_store_n(&ring->head, head, __ATOMIC_SEQ_CST);
+
+        dropped += __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+    }
+
+    if (dropped != dropped_reported)
+	{
+        char text[64];
+        int length = snprintf(text, sizeof(text), "Log buffer full: %lu messages dropped so far", dropped);
+        Entry entry;
+        clock_gettime(CLOCK_REALTIME_COARSE, &entry.time);
+        entry.level = LOG_ERROR;
+        entry.length = length;
+        std::memcpy(entry.text, text, length);
+        format(batch, entry);
+        dropped_reported = dropped;
+    }
+
+    return !batch.empty();
+}
+
+void Logger::wakeWriter()
+{
+    // Nothing useful to do on failure: logging it would come back here.
+    uint64_t one = 1;
+    ssize_t written = ::write(wake_fd, &one, sizeof(one));
+    (void)written;
+}
+
+void* Logger::writerMain(void*)
+{
+    std::string batch;
+    batch.reserve(64 * 1024);
+
+    while (true)
+	{
+        bool stopping = !__atomic_load_n(&running, __ATOMIC_ACQUIRE);
+
+        batch.clear();
+        if (drain(batch))
+            writeAll(batch);
+        else if (stopping)
+            break;
+        else
+		{
+            // Blocks until a producer or stop() signals; the read clears the count.
+            uint64_t count;
+            if (read(wake_fd, &count, sizeof(count)) < 0 && errno != EINTR)
+                break;
+        }
+    }
+    return NULL;
+}
+
+LogLine::LogLine(LogLevel level) : level(level), active(Logger::enabled(level)), length(0) {}
+
+LogLine::~LogLine()
+{
+    if (active)
+        Logger::write(level, buffer, length);
+}
+
+void LogLine::append(const char* data, size_t size)
+{
+    if (!active)
+        return;
+    if (size > Logger::LINE_MAX - length)
+        size = Logger::LINE_MAX - length;
+    std::memcpy(buffer + length, data, size);
+    length += size;
+}
+
+void LogLine::appendNumber(unsigned long value, bool negative)
+{
+    char digits[24];
+    size_t pos = sizeof(digits);
+
+    do
+	{
+        digits[--pos] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    if (negative)
+        digits[--pos] = '-';
+
+    append(digits + pos, sizeof(digits) - pos);
+}
+
+LogLine& LogLine::operator<<(const char* text)
+{
+    if (active)
+        append(text, std::strlen(text));
+    return *this;
+}
+
+LogLine& LogLine::operator<<(const std::string& text)
+{
+    append(text.data(), text.size());
+    return *this;
+}
+
+LogLine& LogLine::operator<<(const StringView& text)
+{
+    append(text.data(), text.size());
+    return *this;
+}
+
+LogLine& LogLine::operator<<(int value)
+{
+    return *this << static_cast<long>(value);
+}
+
+LogLine& LogLine::operator<<(long value)
+{
+    if (value < 0)
+        appendNumber(0UL - static_cast<unsigned long>(value), true);
+    else
+        appendNumber(static_cast<unsigned long>(value), false);
+    return *this;
+}
+
+LogLine& LogLine::operator<<(unsigned int value)
+{
+    appendNumber(value, false);
+    return *this;
+}
+
+LogLine& LogLine::operator<<(unsigned long value)
+{
+    appendNumber(value, false);
+    return *this;
+}
@@ -0,0 +1,111 @@
+#include <Message.hpp>
+#include <cstring>
+
+static const StringView empty_view;
+
+Message::Message() : param_count(0), end(NULL) {}
+
+static const char* skipSpaces(const char* p, const char* end)
+{
+    while (p < end && *p == ' ')
+        ++p;
+    return p;
+}
+
+static const char* findSpace(const char* p, const char* end)
+{
+    const char* space = static_cast<const char*>(std::memchr(p, ' ', end - p));
+    return space ? space : end;
+}
+
+bool Message::parse(const StringView& line)
+{
+    const char* p = line.data();
+    end = p + line.size();
+    tags = StringView();
+    prefix = StringView();
+    command = StringView();
+    param_count = 0;
+
+    p = skipSpaces(p, end);
+    if (p < end && *p == '@')
+	{
+        const char* start = ++p;
+        p = findSpace(p, end);
+        tags = StringView(start, p - start);
+        p = skipSpaces(p, end);
+    }
+
+    if (p < end && *p == ':')
+	{
+        const char* start = ++p;
+        p = findSpace(p, end);
+        prefix = StringView(start, p - start);
+        p = skipSpaces(p, end);
+    }
+
+    const char* start = p;
+    p = findSpace(p, end);
+    command = StringView(start, p - start);
+    if (command.empty())
+        return false;
+
+    while (param_count < MAX_PARAMS)
+	{
+        p = skipSpaces(p, end);
+        if (p == end)
+            break;
+
+        // The last parameter takes the rest of the line, colon or not.
+        if (*p == ':' || param_count == MAX_PARAMS - 1)
+		{
+            if (*p == ':')
+                ++p;
+            params[param_count++] = StringView(p, end - p);
+            break;
+        }
+
+        start = p;
+        p = findSpace(p, end);
+        params[param_count++] = StringView(start, p - start);
+    }
+    return true;
+}
+
+const StringView& Message::getTags() const
+{
+    return tags;
+}
+
+const StringView& Message::getPrefix() const
+{
+    return prefix;
+}
+
+const StringView& Message::getCommand() const
+{
+    return command;
+}
+
+size_t Message::paramCount() const
+{
+    return param_count;
+}
+
+const StringView& Message::param(size_t index) const
+{
+    if (index >= param_count)
+        return empty_view;
+    return params[index];
+}
+
+StringView Message::textFrom(size_t index) const
+{
+    if (index >= param_count)
+        return StringView();
+
+    const char* start = params[index].data();
+    if (start[-1] == ':')
+        return params[index];
+    return StringView(start, end - start);
+}
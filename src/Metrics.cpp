@@ -0,0 +1,328 @@
+#include <Metrics.hpp>
+#include <cstdio>
+#include <pthread.h>
+
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Function-local so that file-scope metric references in other translation
+// units can register during static initialization.
+static std::vector<Metrics::Metric*>& registry()
+{
+    static std::vector<Metrics::Metric*> metrics;
+    return metrics;
+}
+
+static const time_t process_start = time(NULL);
+
+static void appendUnsigned(std::string& out, unsigned long value)
+{
+    char text[24];
+    int length = snprintf(text, sizeof(text), "%lu", value);
+    out.append(text, length);
+}
+
+static void appendSigned(std::string& out, long value)
+{
+    char text[24];
+    int length = snprintf(text, sizeof(text), "%ld", value);
+    out.append(text, length);
+}
+
+static void appendSeconds(std::string& out, unsigned long nanoseconds)
+{
+    char text[32];
+    int length = snprintf(text, sizeof(text), "%.9g", nanoseconds / 1e9);
+    out.append(text, length);
+}
+
+// name{label,extra} with either part optional.
+static void appendSeries(std::string& out, const Metrics::Metric& metric, const char* suffix, const std::string& extra)
+{
+    out += metric.getName();
+    out += suffix;
+    if (metric.getLabel().empty() && extra.empty())
+        return;
+
+    out += '{';
+    out += metric.getLabel();
+    if (!metric.getLabel().empty() && !extra.empty())
+        out += ',';
+    out += extra;
+    out += '}';
+}
+
+Metrics::Metric::Metric(const std::string& name, const std::string& help, const std::string& label, Type type)
+    : name(name), help(help), label(label), type(type) {}
+
+Metrics::Metric::~Metric() {}
+
+const std::string& Metrics::Metric::getName() const
+{
+    return name;
+}
+
+const std::string& Metrics::Metric::getHelp() const
+{
+    return help;
+}
+
+const std::string& Metrics::Metric::getLabel() const
+{
+    return label;
+}
+
+Metrics::Type Metrics::Metric::getType() const
+{
+    return type;
+}
+
+Metrics::Counter::Counter(const std::string& name, const std::string& help, const std::string& label)
+    : Metric(name, help, label, COUNTER), value(0) {}
+
+void Metrics::Counter::add(unsigned long amount)
+{
+    __atomic_add_fetch(&value, amount, __ATOMIC_RELAXED);
+}
+
+unsigned long Metrics::Counter::get() const
+{
+    return __atomic_load_n(&value, __ATOMIC_RELAXED);
+}
+
+void Metrics::Counter::render(std::string& out) const
+{
+    appendSeries(out, *this, "", "");
+    out += ' ';
+    appendUnsigned(out, get());
+    out += '\n';
+}
+
+void Metrics::Counter::summarize(std::string& out) const
+{
+    appendSeries(out, *this, "", "");
+    out += ' ';
+    appendUnsigned(out, get());
+}
+
+Metrics::Gauge::Gauge(const std::string& name, const std::string& help, const std::string& label)
+    : Metric(name, help, label, GAUGE), value(0) {}
+
+void Metrics::Gauge::set(long amount)
+{
+    __atomic_store_n(&value, amount, __ATOMIC_RELAXED);
+}
+
+void Metrics::Gauge::add(long amount)
+{
+    __atomic_add_fetch(&value, amount, __ATOMIC_RELAXED);
+}
+
+long Metrics::Gauge::get() const
+{
+    return __atomic_load_n(&value, __ATOMIC_RELAXED);
+}
+
+void Metrics::Gauge::render(std::string& out) const
+{
+    appendSeries(out, *this, "", "");
+    out += ' ';
+    appendSigned(out, get());
+    out += '\n';
+}
+
+void Metrics::Gauge::summarize(std::string& out) const
+{
+    appendSeries(out, *this, "", "");
+    out += ' ';
+    appendSigned(out, get());
+}
+
+const unsigned long Metrics::Histogram::bounds[Metrics::Histogram::BUCKETS] = {
+    1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000
+};
+
+Metrics::Histogram::Histogram(const std::string& name, const std::string& help, const std::string& label)
+    : Metric(name, help, label, HISTOGRAM), sum(0), count(0)
+{
+    for (size_t i = 0; i <= BUCKETS; ++i)
+        counts[i] = 0;
+}
+
+void Metrics::Histogram::observe(unsigned long nanoseconds)
+{
+    size_t bucket = 0;
+    while (bucket < BUCKETS && nanoseconds > bounds[bucket])
+        ++bucket;
+
+    __atomic_add_fetch(&counts[bucket], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&sum, nanoseconds, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&count, 1, __ATOMIC_RELAXED);
+}
+
+unsigned long Metrics::Histogram::getCount() const
+{
+    return __atomic_load_n(&count, __ATOMIC_RELAXED);
+}
+
+unsigned long Metrics::Histogram::quantile(double q) const
+{
+    unsigned long total = getCount();
+    if (total == 0)
+        return 0;
+
+    unsigned long rank = static_cast<unsigned long>(q * total + 0.5);
+    if (rank == 0)
+        rank = 1;
+
+    unsigned long seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i)
+	{
+        seen += __atomic_load_n(&counts[i], __ATOMIC_RELAXED);
+        if (seen >= rank)
+            return bounds[i];
+    }
+    return bounds[BUCKETS - 1];
+}
+
+void Metrics::Histogram::render(std::string& out) const
+{
+    unsigned long cumulative = 0;
+    for (size_t i = 0; i <= BUCKETS; ++i)
+	{
+        cumulative += __atomic_load_n(&counts[i], __ATOMIC_RELAXED);
+
+        std::string le = "le=\"";
+        if (i < BUCKETS)
+            appendSeconds(le, bounds[i]);
+        else
+            le += "+Inf";
+        le += '"';
+
+        appendSeries(out, *this, "_bucket", le);
+        out += ' ';
+        appendUnsigned(out, cumulative);
+        out += '\n';
+    }
+
+    appendSeries(out, *this, "_sum", "");
+    out += ' ';
+    appendSeconds(out, __atomic_load_n(&sum, __ATOMIC_RELAXED));
+    out += '\n';
+    appendSeries(out, *this, "_count", "");
+    out += ' ';
+    appendUnsigned(out, cumulative);
+    out += '\n';
+}
+
+void Metrics::Histogram::summarize(std::string& out) const
+{
+    appendSeries(out, *this, "", "");
+    out += " count=";
+    appendUnsigned(out, getCount());
+    out += " p50<=";
+    appendUnsigned(out, quantile(0.5) / 1000);
+    out += "us p99<=";
+    appendUnsigned(out, quantile(0.99) / 1000);
+    out += "us";
+}
+
+Metrics::Metric* Metrics::find(const std::string& name, const std::string& label)
+{
+    std::vector<Metric*>& metrics = registry();
+    for (size_t i = 0; i < metrics.size(); ++i)
+	{
+        if (metrics[i]->getName() == name && metrics[i]->getLabel() == label)
+            return metrics[i];
+    }
+    return NULL;
+}
+
+Metrics::Metric* Metrics::add(Metric* metric)
+{
+    registry().push_back(metric);
+    return metric;
+}
+
+Metrics::Counter& Metrics::counter(const std::string& name, const std::string& help, const std::string& label)
+{
+    pthread_mutex_lock(&registry_mutex);
+    Metric* metric = find(name, label);
+    if (!metric)
+        metric = add(new Counter(name, help, label));
+    pthread_mutex_unlock(&registry_mutex);
+    return static_cast<Counter&>(*metric);
+}
+
+Metrics::Gauge& Metrics::gauge(const std::string& name, const std::string& help, const std::string& label)
+{
+    pthread_mutex_lock(&registry_mutex);
+    Metric* metric = find(name, label);
+    if (!metric)
+        metric = add(new Gauge(name, help, label));
+    pthread_mutex_unlock(&registry_mutex);
+    return static_cast<Gauge&>(*metric);
+}
+
+Metrics::Histogram& Metrics::histogram(const std::string& name, const std::string& help, const std::string& label)
+{
+    pthread_mutex_lock(&registry_mutex);
+    Metric* metric = find(name, label);
+    if (!metric)
+        metric = add(new Histogram(name, help, label));
+    pthread_mutex_unlock(&registry_mutex);
+    return static_cast<Histogram&>(*metric);
+}
+
+void Metrics::renderPrometheus(std::string& out)
+{
+    static const char* type_names[] = { "counter", "gauge", "histogram" };
+
+    pthread_mutex_lock(&registry_mutex);
+    std::vector<Metric*>& metrics = registry();
+    std::vector<bool> done(metrics.size(), false);
+
+    // Samples of one family must be contiguous, whatever the registration order.
+    for (size_t i = 0; i < metrics.size(); ++i)
+	{
+        if (done[i])
+            continue;
+
+        out += "# HELP " + metrics[i]->getName() + " " + metrics[i]->getHelp() + "\n";
+        out += "# TYPE " + metrics[i]->getName() + " " + type_names[metrics[i]->getType()] + "\n";
+        for (size_t j = i; j < metrics.size(); ++j)
+		{
+            if (!done[j] && metrics[j]->getName() == metrics[i]->getName())
+			{
+                metrics[j]->render(out);
+                done[j] = true;
+            }
+        }
+    }
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+void Metrics::summarize(std::vector<std::string>& lines)
+{
+    pthread_mutex_lock(&registry_mutex);
+    std::vector<Metric*>& metrics = registry();
+    for (size_t i = 0; i < metrics.size(); ++i)
+	{
+        std::string line;
+        metrics[i]->summarize(line);
+        lines.push_back(line);
+    }
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+unsigned long Metrics::elapsedNanoseconds(const struct timespec& start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) * 1000000000UL + now.tv_nsec - start.tv_nsec;
+}
+
+time_t Metrics::startTime()
+{
+    return process_start;
+}
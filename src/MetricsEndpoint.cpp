@@ -0,0 +1,162 @@
+#include <MetricsEndpoint.hpp>
+#include <Server.hpp>
+#include <Metrics.hpp>
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <sstream>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+MetricsEndpoint::MetricsEndpoint(Server& server)
+    : server(server), listen_fd(-1), thread(), thread_started(false) {}
+
+MetricsEndpoint::~MetricsEndpoint()
+{
+    stop();
+}
+
+void* MetricsEndpoint::threadMain(void* arg)
+{
+    static_cast<MetricsEndpoint*>(arg)->run();
+    return NULL;
+}
+
+bool MetricsEndpoint::start(int port)
+{
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0)
+	{
+        std::cerr << "Error creating metrics socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    int opt = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    if (bind(listen_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listen_fd, 16) < 0)
+	{
+        std::cerr << "Error binding metrics port " << port << ": " << strerror(errno) << std::endl;
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+
+    if (pthread_create(&thread, NULL, threadMain, this) != 0)
+	{
+        std::cerr << "Error creating metrics thread" << std::endl;
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    thread_started = true;
+    std::cout << "Metrics available at http://127.0.0.1:" << port << "/metrics" << std::endl;
+    return true;
+}
+
+void MetricsEndpoint::stop()
+{
+    if (!thread_started)
+        return;
+
+    // Wakes the blocking accept() with EINVAL.
+    shutdown(listen_fd, SHUT_RDWR);
+    pthread_join(thread, NULL);
+    thread_started = false;
+
+    close(listen_fd);
+    listen_fd = -1;
+}
+
+void MetricsEndpoint::run()
+{
+    while (true)
+	{
+        int client_fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (client_fd < 0)
+		{
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            break;
+        }
+        serve(client_fd);
+        close(client_fd);
+    }
+}
+
+static bool sendAll(int fd, const std::string& data)
+{
+    size_t done = 0;
+    while (done < data.size())
+	{
+        ssize_t sent = send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+        if (sent < 0)
+		{
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        done += sent;
+    }
+    return true;
+}
+
+void MetricsEndpoint::serve(int client_fd)
+{
+    struct timeval timeout;
+    timeout.tv_sec = 2;
+    timeout.tv_usec = 0;
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192)
+	{
+        ssize_t received = recv(client_fd, buffer, sizeof(buffer), 0);
+        if (received <= 0)
+            return;
+        request.append(buffer, received);
+    }
+
+    std::string body;
+    std::string status;
+    std::string content_type;
+
+    if (request.compare(0, 13, "GET /metrics ") == 0)
+	{
+        // Only reads the shared state, so one share of the lock is enough.
+        server.lockShare(0);
+        server.refreshMetrics();
+        server.unlockShare(0);
+
+        Metrics::renderPrometheus(body);
+        status = "200 OK";
+        content_type = "text/plain; version=0.0.4";
+    }
+    else
+	{
+        body = "Not found\n";
+        status = "404 Not Found";
+        content_type = "text/plain";
+    }
+
+    std::ostringstream head;
+    head << "HTTP/1.0 " << status << "\r\n"
+         << "Content-Type: " << content_type << "\r\n"
+         << "Content-Length: " << body.size() << "\r\n"
+         << "Connection: close\r\n\r\n";
+
+    if (sendAll(client_fd, head.str()))
+        sendAll(client_fd, body);
+}
@@ -0,0 +1,74 @@
+#include <NickIndex.hpp>
+
+const NickIndex::Id NickIndex::NONE;
+
+NickIndex::NickIndex() {}
+
+NickIndex::~NickIndex()
+{
+    clear();
+}
+
+NickIndex::Id NickIndex::find(const StringView& nickname) const
+{
+    std::tr1::unordered_map<FoldedKey, Id, FoldedHash, FoldedEqual>::const_iterator it = ids.find(nickname);
+    if (it == ids.end())
+        return NONE;
+    return it->second;
+}
+
+NickIndex::Id NickIndex::add(const StringView& nickname, int client_fd)
+{
+    Id id = find(nickname);
+    if (id != NONE)
+	{
+        // The same client changing the case of its nickname.
+        slots[id]->name.assign(nickname.data(), nickname.size());
+        slots[id]->fd = client_fd;
+        return id;
+    }
+
+    if (!free_ids.empty())
+	{
+        id = free_ids.back();
+        free_ids.pop_back();
+    }
+	else
+	{
+        id = static_cast<Id>(slots.size());
+        slots.push_back(NULL);
+    }
+
+    Entry* entry = new Entry();
+    entry->name.assign(nickname.data(), nickname.size());
+    ircFold(nickname, entry->folded);
+    entry->fd = client_fd;
+    slots[id] = entry;
+    ids[StringView(entry->folded)] = id;
+    return id;
+}
+
+void NickIndex::remove(Id id, int client_fd)
+{
+    if (owner(id) == -1 || owner(id) != client_fd)
+        return;
+
+    ids.erase(StringView(slots[id]->folded));
+    delete slots[id];
+    slots[id] = NULL;
+    free_ids.push_back(id);
+}
+
+void NickIndex::clear()
+{
+    for (size_t i = 0; i < slots.size(); ++i)
+        delete slots[i];
+    slots.clear();
+    free_ids.clear();
+    ids.clear();
+}
+
+size_t NickIndex::size() const
+{
+    return ids.size();
+}
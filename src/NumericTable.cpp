@@ -0,0 +1,122 @@
+#include <NumericTable.hpp>
+#include <cstring>
+
+struct NumericText
+{
+	Numeric numeric;
+	const char* code;
+	const char* text;
+};
+
+// What follows "<code> <client> ": '%' is an argument slot, and $server and
+// $network stand for the configured names.
+static const NumericText numeric_texts[] = {
+    { RPL_WELCOME, "001", ":Welcome to the $network Network %" },
+    { RPL_YOURHOST, "002", ":Your host is $server, running version 1.0" },
+    { RPL_CREATED, "003", ":This server was created Apr 2025" },
+    { RPL_MYINFO, "004", "$server 1.0 o o" },
+    { RPL_ISUPPORT, "005", "CASEMAPPING=rfc1459 CHANTYPES=# PREFIX=(o)@ CHANMODES=,k,l,it NETWORK=$network :are supported by this server" },
+    { RPL_STATSCOMMANDS, "212", "% % % 0" },
+    { RPL_ENDOFSTATS, "219", "% :End of STATS report" },
+    { RPL_STATSUPTIME, "242", ":Server Up %" },
+    { RPL_STATSDEBUG, "249", "z :%" },
+    { RPL_CHANNELMODEIS, "324", "% %" },
+    { RPL_NOTOPIC, "331", "% :No topic is set" },
+    { RPL_TOPIC, "332", "% :%" },
+    { RPL_INVITING, "341", "% %" },
+    { RPL_NAMREPLY, "353", "= % :%" },
+    { RPL_ENDOFNAMES, "366", "% :End of /NAMES list." },
+    { RPL_YOUREOPER, "381", ":You are now an IRC operator" },
+    { ERR_NOSUCHNICK, "401", "% :No such nick/channel" },
+    { ERR_NOSUCHCHANNEL, "403", "% :No such channel" },
+    { ERR_NOORIGIN, "409", ":No origin specified" },
+    { ERR_INPUTTOOLONG, "417", ":Input line was too long" },
+    { ERR_UNKNOWNCOMMAND, "421", "% :Unknown command" },
+    { ERR_ERRONEUSNICKNAME, "432", ":Erroneous nickname" },
+    { ERR_NICKNAMEINUSE, "433", "% :Nickname is already in use" },
+    { ERR_USERNOTINCHANNEL, "441", "% % :They aren't on that channel" },
+    { ERR_NOTONCHANNEL, "442", "% :You're not on that channel" },
+    { ERR_USERONCHANNEL, "443", "% % :is already on channel" },
+    { ERR_NOTREGISTERED, "451", ":You have not registered" },
+    { ERR_NEEDMOREPARAMS, "461", "% :Not enough parameters" },
+    { ERR_INVALIDLIMIT, "461", "% :Invalid limit value" },
+    { ERR_PASSWDMISMATCH, "464", ":Password incorrect" },
+    { ERR_PASSWDREQUIRED, "464", ":Password required before registration" },
+    { ERR_CHANNELISFULL, "471", "% :Cannot join channel (+l) - channel is full" },
+    { ERR_INVITEONLYCHAN, "473", "% :Cannot join channel (+i)" },
+    { ERR_BADCHANNELKEY, "475", "% :Cannot join channel (+k) - bad key" },
+    { ERR_NOPRIVILEGES, "481", ":Permission Denied- You're not an IRC operator" },
+    { ERR_CHANOPRIVSNEEDED, "482", "% :You're not channel operator" },
+    { ERR_LASTCHANOP, "482", "% :Cannot remove last operator from channel" },
+    { ERR_NOOPERHOST, "491", ":No O-lines for your host" },
+    { ERR_USERSDONTMATCH, "502", ":Cannot change mode for other users" }
+};
+
+NumericTable::NumericTable(const std::string& server_name, const std::string& network_name)
+{
+    size_t count = sizeof(numeric_texts) / sizeof(numeric_texts[0]);
+    for (size_t i = 0; i < count; ++i)
+        compile(numeric_texts[i].numeric, numeric_texts[i].code, numeric_texts[i].text, server_name, network_name);
+}
+
+void NumericTable::compile(Numeric numeric, const char* code, const char* text,
+                           const std::string& server_name, const std::string& network_name)
+{
+    Template& entry = templates[numeric];
+    entry.text = ":" + server_name + " " + code + " ";
+    entry.ends.push_back(entry.text.size());
+    entry.text += ' ';
+
+    while (*text != '\0')
+	{
+        if (*text == '%')
+		{
+            entry.ends.push_back(entry.text.size());
+            ++text;
+        }
+        else if (std::strncmp(text, "$server", 7) == 0)
+		{
+            entry.text += server_name;
+            text += 7;
+        }
+        else if (std::strncmp(text, "$network", 8) == 0)
+		{
+            entry.text += network_name;
+            text += 8;
+        }
+        else
+            entry.text += *text++;
+    }
+    entry.text += "\r\n";
+    entry.ends.push_back(entry.text.size());
+}
+
+size_t NumericTable::length(Numeric numeric, const StringView& client, const StringView* args, size_t count) const
+{
+    const Template& entry = templates[numeric];
+    size_t total = entry.text.size() + client.size();
+    for (size_t slot = 1; slot + 1 < entry.ends.size() && slot <= count; ++slot)
+        total += args[slot - 1].size();
+    return total;
+}
+
+void NumericTable::render(Reply& out, Numeric numeric, const StringView& client, const StringView* args, size_t count) const
+{
+    const Template& entry = templates[numeric];
+    out.reserve(length(numeric, client, args, count));
+
+    const char* text = entry.text.data();
+    size_t start = 0;
+    for (size_t slot = 0; slot < entry.ends.size(); ++slot)
+	{
+        out.add(text + start, entry.ends[slot] - start);
+        start = entry.ends[slot];
+        if (slot + 1 == entry.ends.size())
+            break;
+
+        if (slot == 0)
+            out.add(client);
+        else if (slot <= count)
+            out.add(args[slot - 1]);
+    }
+}
@@ -0,0 +1,107 @@
+#include <OutputQueue.hpp>
+#include <Metrics.hpp>
+#include <sys/socket.h>
+#include <cerrno>
+
+static Metrics::Counter& writes_metric = Metrics::counter("irc_writes_total", "Writes to client sockets that sent data.");
+static Metrics::Counter& sent_metric = Metrics::counter("irc_sent_bytes_total", "Bytes sent to clients.");
+
+OutputQueue::OutputQueue() : offset(0), pending(0) {}
+
+OutputQueue::~OutputQueue() {}
+
+void OutputQueue::push(const SharedBuffer& data)
+{
+    if (data.empty())
+        return;
+    chunks.push_back(data);
+    pending += data.size();
+}
+
+void OutputQueue::append(const char* data, size_t length)
+{
+    if (length == 0)
+        return;
+
+    // A buffer still held by an asynchronous send is shared, so it is never written to.
+    if (chunks.empty() || !chunks.back().append(data, length))
+        chunks.push_back(SharedBuffer(data, length, length > APPEND_BLOCK ? length : APPEND_BLOCK));
+    pending += length;
+}
+
+bool OutputQueue::empty() const
+{
+    return pending == 0;
+}
+
+size_t OutputQueue::size() const
+{
+    return pending;
+}
+
+void OutputQueue::clear()
+{
+    chunks.clear();
+    offset = 0;
+    pending = 0;
+}
+
+int OutputQueue::prepare(struct iovec* iov, int max_iov, std::vector<SharedBuffer>* hold) const
+{
+    int count = 0;
+    for (std::deque<SharedBuffer>::const_iterator it = chunks.begin();
+         it != chunks.end() && count < max_iov; ++it, ++count)
+	{
+        size_t skip = (count == 0) ? offset : 0;
+        iov[count].iov_base = const_cast<char*>(it->data() + skip);
+        iov[count].iov_len = it->size() - skip;
+        if (hold)
+            hold->push_back(*it);
+    }
+    return count;
+}
+
+void OutputQueue::consume(size_t bytes)
+{
+    writes_metric.add();
+    sent_metric.add(bytes);
+
+    pending -= bytes;
+    while (bytes > 0)
+	{
+        size_t left = chunks.front().size() - offset;
+        if (bytes < left)
+		{
+            offset += bytes;
+            break;
+        }
+        bytes -= left;
+        chunks.pop_front();
+        offset = 0;
+    }
+}
+
+bool OutputQueue::flush(int fd)
+{
+    struct iovec iov[MAX_IOV];
+
+    while (!chunks.empty())
+	{
+        struct msghdr msg = msghdr();
+        msg.msg_iov = iov;
+        msg.msg_iovlen = prepare(iov, MAX_IOV, NULL);
+
+        ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0)
+		{
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return true;
+            return false;
+        }
+
+        consume(sent);
+    }
+    return true;
+}
@@ -0,0 +1,750 @@
+#include <Reactor.hpp>
+#include <Server.hpp>
+#include <Logger.hpp>
+#include <Metrics.hpp>
+#include <iostream>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <cstring>
+#include <algorithm>
+#include <cerrno>
+#include <stdint.h>
+
+__thread Reactor* Reactor::current_reactor = NULL;
+
+// How soon accepting is retried after the process ran out of descriptors.
+static const long ACCEPT_RETRY_MS = 100;
+
+static Metrics::Counter& accepts_metric = Metrics::counter("irc_accepts_total", "Client connections accepted.");
+static Metrics::Counter& reads_metric = Metrics::counter("irc_reads_total", "Reads from client sockets.");
+static Metrics::Counter& received_metric = Metrics::counter("irc_received_bytes_total", "Bytes received from clients.");
+static Metrics::Counter& throttles_metric = Metrics::counter("irc_flood_throttles_total", "Times a client's input was paused by flood control.");
+static Metrics::Counter& flood_kills_metric = Metrics::counter("irc_flood_disconnects_total", "Clients disconnected for excess flood.");
+static Metrics::Counter& pings_metric = Metrics::counter("irc_pings_sent_total", "Keepalive PINGs sent to idle clients.");
+static Metrics::Counter& ping_timeouts_metric = Metrics::counter("irc_timeouts_total", "Clients disconnected by a timeout.", "reason=\"ping\"");
+static Metrics::Counter& registration_timeouts_metric = Metrics::counter("irc_timeouts_total", "Clients disconnected by a timeout.", "reason=\"registration\"");
+
+Reactor::Reactor(Server& server, const ServerConfig& config, size_t index, size_t reactor_count)
+    : server(server), config(config), index(index), listen_fd(-1), wake_fd(-1), backend(NULL),
+      thread(), thread_started(false), state_exclusive(false), connections(server.getConnections()), outbox(reactor_count), fanout_members(NULL),
+      fanout_message(NULL), fanout_exclude(-1), accept_wakeups(0), accepted_total(0), max_accept_batch(0)
+{
+    pthread_mutex_init(&mailbox_mutex, NULL);
+}
+
+Reactor::~Reactor()
+{
+    delete backend;
+    if (listen_fd >= 0)
+        close(listen_fd);
+    if (wake_fd >= 0)
+        close(wake_fd);
+
+    pthread_mutex_destroy(&mailbox_mutex);
+}
+
+Reactor* Reactor::current()
+{
+    return current_reactor;
+}
+
+size_t Reactor::getIndex() const
+{
+    return index;
+}
+
+bool Reactor::setup(bool reuse_port)
+{
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0)
+	{
+        std::cerr << "Error creating socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    int opt = 1;
+    if (setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0
+        || (reuse_port && setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0))
+	{
+        std::cerr << "Error configuring socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(config.port);
+
+    if (bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+	{
+        std::cerr << "Error during bind: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    if (listen(listen_fd, config.backlog) < 0)
+	{
+        std::cerr << "Error while listening: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0)
+	{
+        std::cerr << "Error creating eventfd: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    backend = createEventBackend(config, listen_fd);
+    if (!backend)
+        return false;
+
+    if (!timers.setup())
+        return false;
+
+    if (Server::getShutdownFd() < 0 || !backend->watch(wake_fd) || !backend->watch(Server::getShutdownFd())
+        || !backend->watch(timers.getFd()))
+	{
+        std::cerr << "Error watching eventfd: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    if (index == 0)
+        std::cout << "Using " << backend->name() << " I/O backend" << std::endl;
+
+    return true;
+}
+
+void* Reactor::threadMain(void* arg)
+{
+    static_cast<Reactor*>(arg)->run();
+    return NULL;
+}
+
+bool Reactor::start()
+{
+    if (pthread_create(&thread, NULL, threadMain, this) != 0)
+	{
+        std::cerr << "Error creating reactor thread " << index << std::endl;
+        return false;
+    }
+    thread_started = true;
+    return true;
+}
+
+void Reactor::join()
+{
+    if (thread_started)
+	{
+        pthread_join(thread, NULL);
+        thread_started = false;
+    }
+}
+
+void Reactor::lockState()
+{
+    server.lockState();
+    state_exclusive = true;
+    drainMailbox();
+}
+
+void Reactor::lockShare()
+{
+    server.lockShare(index);
+    state_exclusive = false;
+    drainMailbox();
+}
+
+void Reactor::unlockState()
+{
+    flushOutbox();
+    if (state_exclusive)
+        server.unlockState();
+    else
+        server.unlockShare(index);
+}
+
+void Reactor::onAcceptBatch(int count)
+{
+    accept_wakeups++;
+    accepted_total += count;
+    if (count > max_accept_batch)
+        max_accept_batch = count;
+
+    if (count > 1)
+        LogLine(LOG_DEBUG) << "Accepted " << count << " connections in one wakeup";
+}
+
+void Reactor::onAccept(int client_fd)
+{
+    if (!backend->addClient(client_fd))
+	{
+        LogLine(LOG_ERROR) << "Error registering client socket: " << strerror(errno);
+        close(client_fd);
+        return;
+    }
+
+    lockState();
+    unsigned long id = server.registerClient(client_fd, this);
+    unlockState();
+
+    if (id == 0)
+	{
+        LogLine(LOG_ERROR) << "Error registering client: fd " << client_fd << " is past the descriptor limit";
+        OutputQueue none;
+        backend->close(client_fd, none, false);
+        return;
+    }
+
+    // Until the client registers, its keepalive timer is the registration deadline.
+    Connection* conn = connections.find(client_fd);
+    conn->last_activity = timers.now();
+    timers.schedule(conn->keepalive, config.registration_timeout * 1000L);
+
+    accepts_metric.add();
+    LogLine(LOG_INFO) << "New connection accepted! Client fd: " << client_fd;
+}
+
+void Reactor::onHangup(int client_fd, int error)
+{
+    if (!connections.find(client_fd))
+        return;
+
+    if (error == 0)
+        LogLine(LOG_INFO) << "Client disconnected (fd: " << client_fd << ")";
+    else
+        LogLine(LOG_ERROR) << "Error receiving data: " << strerror(error);
+
+    lockState();
+    server.disconnectClient(client_fd);
+    unlockState();
+}
+
+void Reactor::onData(int client_fd, const char* data, size_t length)
+{
+    Connection* conn = connections.find(client_fd);
+    if (!conn)
+        return;
+
+    reads_metric.add();
+    received_metric.add(length);
+
+    // Anything the client sends answers a keepalive PING.
+    conn->last_activity = timers.now();
+    conn->flags &= ~Connection::PING_SENT;
+
+    conn->input.feed(data, length);
+
+    // A throttled connection keeps what arrives after its reads were paused.
+    if (conn->flags & Connection::THROTTLED)
+        conn->input.hold();
+    else
+        processInput(*conn);
+}
+
+// Runs the buffered lines until the input or the flood budget runs out.
+// Returns true when lines are left waiting for the budget.
+bool Reactor::processInput(Connection& conn)
+{
+    int client_fd = conn.fd;
+    InputBuffer& input = conn.input;
+    StringView line;
+    bool locked = false;
+    bool throttled_now = false;
+
+    // Checked before every line, so that a connection closed by another path
+    // does not run what it still has buffered.
+    while (connections.find(client_fd) && !(conn.flags & Connection::CLOSING))
+	{
+        if (conn.flood.isOverdrawn() && !conn.flood.refill(config))
+		{
+            if (input.hasUnread())
+			{
+                throttle(conn);
+                throttled_now = true;
+            }
+            break;
+        }
+
+        InputBuffer::Result result = input.next(line);
+        if (result == InputBuffer::NONE)
+            break;
+
+        // Lines that only read the shared state run under this reactor's share;
+        // a line that changes it trades the share for the whole lock.
+        bool shared = result == InputBuffer::TOO_LONG || server.isSharedCommand(line);
+        if (locked && !shared && !state_exclusive)
+		{
+            unlockState();
+            locked = false;
+        }
+
+        if (!locked)
+		{
+            // Draining the mailbox can overflow the output queue and close the connection.
+            if (shared)
+                lockShare();
+            else
+                lockState();
+            locked = true;
+            if (conn.flags & Connection::CLOSING)
+                break;
+        }
+
+        if (result == InputBuffer::TOO_LONG)
+            server.rejectLongLine(client_fd);
+        else if (!line.empty())
+		{
+            if (Logger::enabled(LOG_TRACE))
+                LogLine(LOG_TRACE) << "Received from client " << client_fd << ": " << line;
+
+            server.processCommand(client_fd, line);
+        }
+    }
+
+    if (locked)
+        unlockState();
+    return throttled_now;
+}
+
+// A connection already throttled keeps the time it started, so that one line
+// let through per refill does not reset the flood timeout.
+void Reactor::throttle(Connection& conn)
+{
+    conn.input.hold();
+    if (!(conn.flags & Connection::THROTTLED))
+	{
+        conn.flags |= Connection::THROTTLED;
+        conn.flood.markThrottled();
+        backend->setReading(conn.fd, false);
+        throttles_metric.add();
+    }
+    timers.schedule(conn.flood_timer, conn.flood.refillDelay(config));
+}
+
+// Runs the held lines of a throttled connection once its buckets have refilled.
+// Only a client whose input is still over budget after those lines, and has
+// been throughout the flood timeout, is disconnected: waiting out one large
+// overdraft is not flooding.
+void Reactor::serviceThrottled(Connection& conn)
+{
+    if (!(conn.flags & Connection::THROTTLED) || (conn.flags & Connection::CLOSING))
+        return;
+
+    if (!conn.flood.refill(config))
+	{
+        timers.schedule(conn.flood_timer, conn.flood.refillDelay(config));
+        return;
+    }
+
+    int client_fd = conn.fd;
+    bool still_throttled = processInput(conn);
+    Connection* current = connections.find(client_fd);
+    if (!current || (current->flags & Connection::CLOSING))
+        return;
+
+    if (!still_throttled)
+	{
+        current->flags &= ~Connection::THROTTLED;
+        backend->setReading(client_fd, true);
+    }
+    else if (current->flood.throttledFor() >= config.flood_timeout * 1000L)
+        disconnectFlooder(*current);
+}
+
+void Reactor::disconnectFlooder(Connection& conn)
+{
+    LogLine(LOG_INFO) << "Excess flood from client " << conn.fd;
+    flood_kills_metric.add();
+    closeLink(conn, "Excess Flood");
+}
+
+void Reactor::closeLink(Connection& conn, const std::string& reason)
+{
+    int client_fd = conn.fd;
+
+    lockState();
+    server.sendToClient(client_fd, "ERROR :Closing Link: " + conn.user.getHostname() + " (" + reason + ")\r\n");
+    server.disconnectClient(client_fd, reason);
+    unlockState();
+}
+
+// Called when the keepalive timer fires. An unregistered client has reached
+// its registration deadline; a registered one either was idle for the ping
+// interval and gets a PING, let the ping timeout pass without answering,
+// or was active since and has its timer pushed back.
+void Reactor::checkKeepalive(Connection& conn)
+{
+    if (conn.flags & Connection::CLOSING)
+        return;
+
+    unsigned long now = timers.now();
+    long idle_ms = static_cast<long>(now - conn.last_activity) * TimerWheel::TICK_MS;
+
+    lockShare();
+    bool registered = conn.user.isAuthenticated();
+    unlockState();
+
+    if (!registered)
+	{
+        LogLine(LOG_INFO) << "Registration timeout for client " << conn.fd;
+        registration_timeouts_metric.add();
+        closeLink(conn, "Registration timed out");
+    }
+    else if (conn.flags & Connection::PING_SENT)
+	{
+        std::ostringstream reason;
+        reason << "Ping timeout: " << idle_ms / 1000 << " seconds";
+        LogLine(LOG_INFO) << "Ping timeout for client " << conn.fd;
+        ping_timeouts_metric.add();
+        closeLink(conn, reason.str());
+    }
+    else if (idle_ms >= config.ping_interval * 1000L)
+	{
+        conn.flags |= Connection::PING_SENT;
+        pings_metric.add();
+        queueOutput(conn.fd, SharedBuffer("PING :" + config.server_name + "\r\n"));
+        timers.schedule(conn.keepalive, config.ping_timeout * 1000L);
+    }
+    else
+        timers.schedule(conn.keepalive, config.ping_interval * 1000L - idle_ms);
+}
+
+void Reactor::runTimers()
+{
+    timers.advance();
+
+    while (TimerWheel::Timer* timer = timers.popExpired())
+	{
+        if (timer == &accept_timer)
+		{
+            backend->retryAccept(*this);
+            continue;
+        }
+
+        Connection* conn = connections.find(timer->fd);
+        if (!conn || conn->reactor != this)
+            continue;
+
+        if (timer == &conn->keepalive)
+            checkKeepalive(*conn);
+        else
+            serviceThrottled(*conn);
+    }
+
+    timers.rearm();
+}
+
+void Reactor::onWritable(int client_fd)
+{
+    Connection* conn = connections.find(client_fd);
+    if (!conn || (conn->flags & Connection::CLOSING))
+        return;
+
+    if (!backend->send(client_fd, conn->output))
+	{
+        LogLine(LOG_ERROR) << "Error sending data: " << strerror(errno);
+        markClosing(*conn);
+    }
+}
+
+// Keeps retrying while descriptors stay exhausted: each failed retry lands here again.
+void Reactor::onAcceptStalled()
+{
+    if (!accept_timer.isPending())
+        timers.schedule(accept_timer, ACCEPT_RETRY_MS);
+}
+
+void Reactor::onWatch(int fd)
+{
+    if (fd == timers.getFd())
+        runTimers();
+    // The shutdown eventfd is left readable; run() sees that the server stopped.
+    if (fd != wake_fd)
+        return;
+
+    uint64_t count;
+    while (read(wake_fd, &count, sizeof(count)) > 0)
+        ;
+
+    // Posted fds may have been closed and reused by another reactor since,
+    // so the mailbox is checked against the table under this reactor's share.
+    lockShare();
+    unlockState();
+}
+
+void Reactor::queueOutput(int client_fd, const SharedBuffer& message)
+{
+    Connection* conn = connections.find(client_fd);
+    if (!conn || (conn->flags & Connection::CLOSING))
+        return;
+
+    conn->output.push(message);
+    queued(*conn);
+}
+
+void Reactor::queueOutput(int client_fd, const StringView& message)
+{
+    Connection* conn = connections.find(client_fd);
+    if (!conn || (conn->flags & Connection::CLOSING))
+        return;
+
+    conn->output.append(message.data(), message.size());
+    queued(*conn);
+}
+
+void Reactor::queued(Connection& conn)
+{
+    // Written once at the end of the loop iteration, unless it is already too big.
+    if (conn.output.size() > Server::MAX_SENDQ)
+        sendOutput(conn);
+    else if (!(conn.flags & Connection::DIRTY))
+	{
+        conn.flags |= Connection::DIRTY;
+        dirty.push_back(conn.fd);
+    }
+}
+
+void Reactor::sendOutput(Connection& conn)
+{
+    conn.flags &= ~Connection::DIRTY;
+
+    if (!backend->send(conn.fd, conn.output))
+        markClosing(conn);
+    else if (conn.output.size() > Server::MAX_SENDQ)
+	{
+        LogLine(LOG_INFO) << "SendQ exceeded for client " << conn.fd;
+        markClosing(conn);
+    }
+}
+
+void Reactor::flushOutput()
+{
+    for (size_t i = 0; i < dirty.size(); ++i)
+	{
+        Connection* conn = connections.find(dirty[i]);
+        if (conn && conn->reactor == this && (conn->flags & Connection::DIRTY)
+            && !(conn->flags & Connection::CLOSING))
+            sendOutput(*conn);
+    }
+    dirty.clear();
+}
+
+void Reactor::markClosing(Connection& conn)
+{
+    conn.flags |= Connection::CLOSING;
+    pending_disconnects.push_back(conn.fd);
+}
+
+void Reactor::post(Reactor& target, int client_fd, unsigned long id, const SharedBuffer& message)
+{
+    MailboxItem item;
+    item.fd = client_fd;
+    item.id = id;
+    item.message = message;
+    outbox[target.index].push_back(item);
+}
+
+void Reactor::flushOutbox()
+{
+    for (size_t i = 0; i < outbox.size(); ++i)
+	{
+        if (outbox[i].empty())
+            continue;
+
+        Reactor& target = server.getReactor(i);
+        pthread_mutex_lock(&target.mailbox_mutex);
+        if (target.mailbox.empty())
+            target.mailbox.swap(outbox[i]);
+        else
+            target.mailbox.insert(target.mailbox.end(), outbox[i].begin(), outbox[i].end());
+        pthread_mutex_unlock(&target.mailbox_mutex);
+
+        outbox[i].clear();
+        target.wake();
+    }
+}
+
+bool Reactor::fanOut(FanoutPool& pool, const std::vector<Channel::Member>& members,
+                     const SharedBuffer& message, int exclude_fd)
+{
+    if (fanout_slices.size() < pool.sliceCount())
+	{
+        fanout_slices.resize(pool.sliceCount());
+        for (size_t i = 0; i < fanout_slices.size(); ++i)
+            fanout_slices[i].outbox.resize(outbox.size());
+    }
+
+    fanout_members = &members;
+    fanout_message = &message;
+    fanout_exclude = exclude_fd;
+    if (!pool.run(*this, members.size()))
+        return false;
+
+    // Slices cover disjoint members, so merging them slice by slice keeps
+    // each recipient's order; only the lists shared by the reactor are joined here.
+    for (size_t i = 0; i < pool.sliceCount(); ++i)
+	{
+        FanoutSlice& slice = fanout_slices[i];
+        dirty.insert(dirty.end(), slice.dirty.begin(), slice.dirty.end());
+        slice.dirty.clear();
+
+        for (size_t j = 0; j < slice.overflow.size(); ++j)
+		{
+            Connection* conn = connections.find(slice.overflow[j]);
+            if (conn && !(conn->flags & Connection::CLOSING))
+                sendOutput(*conn);
+        }
+        slice.overflow.clear();
+
+        for (size_t target = 0; target < slice.outbox.size(); ++target)
+		{
+            if (slice.outbox[target].empty())
+                continue;
+            outbox[target].insert(outbox[target].end(), slice.outbox[target].begin(), slice.outbox[target].end());
+            slice.outbox[target].clear();
+        }
+    }
+
+    return true;
+}
+
+// Runs on a pool worker for every slice but 0. It only touches the output
+// queues and flags of its own members and the lists of its slice.
+void Reactor::runSlice(size_t slice, size_t begin, size_t end)
+{
+    FanoutSlice& out = fanout_slices[slice];
+    const std::vector<Channel::Member>& members = *fanout_members;
+
+    // Workers queue their own copy of the message, so that each thread counts
+    // references on its own cache line instead of sharing one.
+    SharedBuffer copy;
+    if (slice > 0)
+        copy = SharedBuffer(fanout_message->data(), fanout_message->size());
+    const SharedBuffer& message = (slice > 0) ? copy : *fanout_message;
+
+    for (size_t i = begin; i < end; ++i)
+	{
+        const Channel::Member& member = members[i];
+        if (!(member.flags & Channel::JOINED) || member.fd == fanout_exclude || member.fd <= 0)
+            continue;
+
+        Connection* conn = connections.find(member.fd);
+        if (!conn)
+            continue;
+
+        if (conn->reactor != this)
+		{
+            MailboxItem item;
+            item.fd = conn->fd;
+            item.id = conn->id;
+            item.message = message;
+            out.outbox[conn->reactor->index].push_back(item);
+            continue;
+        }
+
+        if (conn->flags & Connection::CLOSING)
+            continue;
+
+        conn->output.push(message);
+        if (conn->output.size() > Server::MAX_SENDQ)
+            out.overflow.push_back(conn->fd);
+        else if (!(conn->flags & Connection::DIRTY))
+		{
+            conn->flags |= Connection::DIRTY;
+            out.dirty.push_back(conn->fd);
+        }
+    }
+}
+
+void Reactor::drainMailbox()
+{
+    std::vector<MailboxItem> items;
+
+    pthread_mutex_lock(&mailbox_mutex);
+    items.swap(mailbox);
+    pthread_mutex_unlock(&mailbox_mutex);
+
+    for (size_t i = 0; i < items.size(); ++i)
+	{
+        Connection* conn = connections.find(items[i].fd);
+        if (conn && conn->reactor == this && conn->id == items[i].id)
+            queueOutput(items[i].fd, items[i].message);
+    }
+}
+
+void Reactor::wake()
+{
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        LogLine(LOG_ERROR) << "Error waking reactor " << index << ": " << strerror(errno);
+}
+
+void Reactor::closeConnection(int client_fd)
+{
+    Connection* conn = connections.find(client_fd);
+    if (!conn || conn->reactor != this)
+        return;
+
+    timers.cancel(conn->keepalive);
+    timers.cancel(conn->flood_timer);
+
+    // Once released the fd can be taken by another reactor, whose record
+    // flushOutput must not read without the lock. DIRTY does not tell: a
+    // queue written early for its size leaves its fd in the list.
+    dirty.erase(std::remove(dirty.begin(), dirty.end(), client_fd), dirty.end());
+
+    if (client_fd > 0)
+        backend->close(client_fd, conn->output, !(conn->flags & Connection::CLOSING));
+
+    connections.release(client_fd);
+}
+
+void Reactor::processPendingDisconnects()
+{
+    if (pending_disconnects.empty())
+        return;
+
+    lockState();
+    // Disconnecting can queue more entries; an fd closed and reused since it was
+    // queued no longer has CLOSING set and is skipped.
+    for (size_t i = 0; i < pending_disconnects.size(); ++i)
+	{
+        int client_fd = pending_disconnects[i];
+        Connection* conn = connections.find(client_fd);
+        if (conn && conn->reactor == this && (conn->flags & Connection::CLOSING))
+            server.disconnectClient(client_fd);
+    }
+    pending_disconnects.clear();
+    unlockState();
+}
+
+void Reactor::run()
+{
+    current_reactor = this;
+
+    while (Server::isRunning())
+	{
+        if (!backend->wait(*this, -1))
+            break;
+
+        // Replies produced while handling this batch of events go out together,
+        // one gathered write per connection; disconnects can produce more.
+        do
+		{
+            flushOutput();
+            processPendingDisconnects();
+        } while (!dirty.empty());
+    }
+
+    current_reactor = NULL;
+}
+
+void Reactor::printAcceptStats() const
+{
+    std::cout << "Reactor " << index << ": accepted " << accepted_total << " connections over "
+              << accept_wakeups << " wakeups (largest batch: " << max_accept_batch << ")" << std::endl;
+}
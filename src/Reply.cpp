@@ -0,0 +1,54 @@
+#include <Reply.hpp>
+
+Reply::Reply(Arena& arena, size_t expected)
+    : arena(&arena), buffer(arena.allocate(expected)), length(0), capacity(expected) {}
+
+void Reply::grow(size_t needed)
+{
+    size_t new_capacity = capacity * 2;
+    if (new_capacity < needed)
+        new_capacity = needed;
+
+    if (arena->extend(buffer, capacity, new_capacity))
+	{
+        capacity = new_capacity;
+        return;
+    }
+
+    char* moved = arena->allocate(new_capacity);
+    std::memcpy(moved, buffer, length);
+    buffer = moved;
+    capacity = new_capacity;
+}
+
+Reply& Reply::number(unsigned long value)
+{
+    char digits[24];
+    size_t count = 0;
+    do
+	{
+        digits[count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    if (capacity - length < count)
+        grow(length + count);
+    while (count > 0)
+        buffer[length++] = digits[--count];
+    return *this;
+}
+
+const char* Reply::data() const
+{
+    return buffer;
+}
+
+size_t Reply::size() const
+{
+    return length;
+}
+
+StringView Reply::view() const
+{
+    return StringView(buffer, length);
+}
@@ -0,0 +1,154 @@
+#include <Resolver.hpp>
+#include <Server.hpp>
+#include <iostream>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+
+Resolver::Resolver(Server& server)
+    : server(server), thread(), thread_started(false), stopping(false)
+{
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&ready, NULL);
+}
+
+Resolver::~Resolver()
+{
+    stop();
+    pthread_cond_destroy(&ready);
+    pthread_mutex_destroy(&mutex);
+}
+
+void* Resolver::threadMain(void* arg)
+{
+    static_cast<Resolver*>(arg)->run();
+    return NULL;
+}
+
+bool Resolver::start()
+{
+    if (pthread_create(&thread, NULL, threadMain, this) != 0)
+	{
+        std::cerr << "Error creating resolver thread" << std::endl;
+        return false;
+    }
+    thread_started = true;
+    return true;
+}
+
+void Resolver::stop()
+{
+    if (!thread_started)
+        return;
+
+    pthread_mutex_lock(&mutex);
+    stopping = true;
+    requests.clear();
+    pthread_cond_signal(&ready);
+    pthread_mutex_unlock(&mutex);
+
+    pthread_join(thread, NULL);
+    thread_started = false;
+}
+
+void Resolver::resolve(int client_fd, unsigned long id, const struct sockaddr_storage& addr, socklen_t addr_len)
+{
+    if (!thread_started)
+        return;
+
+    Request request;
+    request.fd = client_fd;
+    request.id = id;
+    request.addr = addr;
+    request.addr_len = addr_len;
+
+    pthread_mutex_lock(&mutex);
+    requests.push_back(request);
+    pthread_cond_signal(&ready);
+    pthread_mutex_unlock(&mutex);
+}
+
+void Resolver::run()
+{
+    pthread_mutex_lock(&mutex);
+    while (true)
+	{
+        while (requests.empty() && !stopping)
+            pthread_cond_wait(&ready, &mutex);
+        if (stopping)
+            break;
+
+        Request request = requests.front();
+        requests.pop_front();
+        pthread_mutex_unlock(&mutex);
+
+        std::string host = lookup(request.addr, request.addr_len);
+        if (!host.empty())
+		{
+            server.lockState();
+            server.updateHostname(request.fd, request.id, host);
+            server.unlockState();
+        }
+
+        pthread_mutex_lock(&mutex);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+std::string Resolver::numericHost(const struct sockaddr_storage& addr, socklen_t addr_len)
+{
+    char host[NI_MAXHOST];
+    if (getnameinfo(reinterpret_cast<const struct sockaddr*>(&addr), addr_len,
+                    host, sizeof(host), NULL, 0, NI_NUMERICHOST) != 0)
+        return "localhost";
+
+    // A leading ':' (as in "::1") would end the prefix early.
+    if (host[0] == ':')
+        return std::string("0") + host;
+    return host;
+}
+
+static bool sameAddress(const struct sockaddr_storage& addr, const struct sockaddr* other)
+{
+    if (addr.ss_family != other->sa_family)
+        return false;
+
+    if (addr.ss_family == AF_INET)
+        return std::memcmp(&reinterpret_cast<const struct sockaddr_in*>(&addr)->sin_addr,
+                           &reinterpret_cast<const struct sockaddr_in*>(other)->sin_addr,
+                           sizeof(struct in_addr)) == 0;
+    if (addr.ss_family == AF_INET6)
+        return std::memcmp(&reinterpret_cast<const struct sockaddr_in6*>(&addr)->sin6_addr,
+                           &reinterpret_cast<const struct sockaddr_in6*>(other)->sin6_addr,
+                           sizeof(struct in6_addr)) == 0;
+    return false;
+}
+
+std::string Resolver::lookup(const struct sockaddr_storage& addr, socklen_t addr_len)
+{
+    char host[NI_MAXHOST];
+    if (getnameinfo(reinterpret_cast<const struct sockaddr*>(&addr), addr_len,
+                    host, sizeof(host), NULL, 0, NI_NAMEREQD) != 0)
+        return "";
+
+    size_t length = std::strlen(host);
+    if (length == 0 || length > MAX_HOSTNAME || host[0] == ':' || std::strpbrk(host, " !@*?,") != NULL)
+        return "";
+
+    // Only trust the name if it resolves back to the peer address.
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = addr.ss_family;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* results = NULL;
+    if (getaddrinfo(host, NULL, &hints, &results) != 0)
+        return "";
+
+    bool confirmed = false;
+    for (struct addrinfo* it = results; it && !confirmed; it = it->ai_next)
+        confirmed = sameAddress(addr, it->ai_addr);
+    freeaddrinfo(results);
+
+    return confirmed ? std::string(host) : std::string();
+}
@@ -1,31 +1,52 @@
 #include <Server.hpp>
+#include <Reactor.hpp>
+#include <Metrics.hpp>
 #include <iostream>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <unistd.h>
-#include <cstring>
-#include <cerrno>
-#include <sys/epoll.h>
 #include <sstream>
 #include <algorithm>
 #include <signal.h>
 #include <vector>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <stdint.h>
 
-bool Server::running = true;
+volatile sig_atomic_t Server::running = 1;
+int Server::shutdown_fd = -1;
+
+static Metrics::Gauge& clients_metric = Metrics::gauge("irc_clients", "Connected clients.");
+static Metrics::Counter& disconnects_metric = Metrics::counter("irc_disconnects_total", "Closed client connections.");
+static Metrics::Gauge& channels_metric = Metrics::gauge("irc_channels", "Existing channels.");
+static Metrics::Counter& fanouts_metric = Metrics::counter("irc_fanout_broadcasts_total", "Channel broadcasts split across the fan-out threads.");
+static Metrics::Gauge& largest_channel_metric = Metrics::gauge("irc_largest_channel_members", "Members of the largest channel.");
 
 void Server::handleSignal(int signal)
 {
     if (signal == SIGINT)
 	{
 		std::cout << "\nReceiving SIGINT (Ctrl+C). Shutting down server..." << std::endl;
-        running = false;
+        running = 0;
+
+        uint64_t one = 1;
+        ssize_t written = write(shutdown_fd, &one, sizeof(one));
+        (void)written;
     }
 }
 
-Server::Server(int port, const std::string& password)
-    : port(port), password(password), server_fd(-1), epoll_fd(-1)
+Server::Server(const ServerConfig& config)
+    : config(config), numerics(config.server_name, config.network_name), resolver(*this), metrics_endpoint(*this), next_connection_id(1)
 {
-    command_handler = new Command(this, users, channels, password);
+    size_t count = static_cast<size_t>(config.threads);
+    state_shares.resize(count);
+    for (size_t i = 0; i < count; ++i)
+	{
+        command_handlers.push_back(new Command(this, connections, nicks, channels, config.password));
+        pthread_mutex_init(&state_shares[i], NULL);
+    }
+
+    // Created once and kept for the life of the process, like the handler.
+    if (shutdown_fd < 0)
+        shutdown_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
 
     struct sigaction sa;
     sa.sa_handler = handleSignal;
@@ -37,270 +58,275 @@ Server::Server(int port, const std::string& password)
 Server::~Server()
 {
     cleanupResources();
+    for (size_t i = 0; i < state_shares.size(); ++i)
+        pthread_mutex_destroy(&state_shares[i]);
 }
 
 void Server::cleanupResources()
 {
+    resolver.stop();
+    metrics_endpoint.stop();
+    fanout_pool.stop();
+
     std::vector<int> client_fds;
-    for (std::map<int, User>::iterator it = users.begin(); it != users.end(); ++it)
-        client_fds.push_back(it->first);
+    connections.listFds(client_fds);
 
     for (size_t i = 0; i < client_fds.size(); ++i)
         disconnectClient(client_fds[i]);
 
-    if (server_fd >= 0)
-	{
-        close(server_fd);
-        server_fd = -1;
-    }
+    for (size_t i = 0; i < reactors.size(); ++i)
+        delete reactors[i];
+    reactors.clear();
 
-    if (epoll_fd >= 0)
-	{
-        close(epoll_fd);
-        epoll_fd = -1;
-    }
+    for (size_t i = 0; i < command_handlers.size(); ++i)
+        delete command_handlers[i];
+    command_handlers.clear();
+}
 
-    delete command_handler;
-    command_handler = NULL;
+bool Server::isRunning()
+{
+    return running != 0;
 }
 
-void Server::setupSocket()
+int Server::getShutdownFd()
 {
-    server_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_fd < 0)
-	{
-        std::cerr << "Error creating socket: " << strerror(errno) << std::endl;
-        return;
-    }
+    return shutdown_fd;
+}
 
-    int opt = 1;
-    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-        std::cerr << "Error configuring socket: " << strerror(errno) << std::endl;
-        close(server_fd);
-        server_fd = -1;
-        return;
-    }
+// Always in index order, and never by a thread already holding a share, so
+// two threads taking every share cannot deadlock.
+void Server::lockState()
+{
+    for (size_t i = 0; i < state_shares.size(); ++i)
+        pthread_mutex_lock(&state_shares[i]);
+}
 
-    struct sockaddr_in address;
-    std::memset(&address, 0, sizeof(address));
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(port);
+void Server::unlockState()
+{
+    for (size_t i = state_shares.size(); i > 0; --i)
+        pthread_mutex_unlock(&state_shares[i - 1]);
+}
 
-    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0)
-	{
-        std::cerr << "Error during bind: " << strerror(errno) << std::endl;
-        close(server_fd);
-        server_fd = -1;
-        return;
-    }
+void Server::lockShare(size_t index)
+{
+    pthread_mutex_lock(&state_shares[index]);
+}
 
-    if (listen(server_fd, 10) < 0)
-	{
-        std::cerr << "Error while listening: " << strerror(errno) << std::endl;
-        close(server_fd);
-        server_fd = -1;
-        return;
-    }
+void Server::unlockShare(size_t index)
+{
+    pthread_mutex_unlock(&state_shares[index]);
+}
 
-    epoll_fd = epoll_create1(0);
-    if (epoll_fd < 0)
-	{
-        std::cerr << "Error creating epoll instance: " << strerror(errno) << std::endl;
-        close(server_fd);
-        server_fd = -1;
-        return;
-    }
+Reactor& Server::getReactor(size_t index)
+{
+    return *reactors[index];
+}
 
-    struct epoll_event event;
-    event.events = EPOLLIN;
-    event.data.fd = server_fd;
-    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, server_fd, &event) < 0)
-	{
-        std::cerr << "Error adding server socket to epoll: " << strerror(errno) << std::endl;
-        close(server_fd);
-        close(epoll_fd);
-        server_fd = -1;
-        epoll_fd = -1;
-        return;
-    }
+const ServerConfig& Server::getConfig() const
+{
+    return config;
+}
 
-    std::cout << "Server started on port " << port << std::endl;
-    std::cout << "Waiting for connections..." << std::endl;
+const NumericTable& Server::getNumerics() const
+{
+    return numerics;
 }
 
-void Server::handleNewConnection()
+ConnectionTable& Server::getConnections()
 {
-    int client_fd;
-    struct sockaddr_in client_addr;
-    socklen_t addr_len = sizeof(client_addr);
+    return connections;
+}
 
-    client_fd = accept(server_fd, (struct sockaddr *)&client_addr, &addr_len);
-    if (client_fd < 0)
-	{
-        std::cerr << "Error accepting connection: " << strerror(errno) << std::endl;
-        return;
-    }
+unsigned long Server::registerClient(int client_fd, Reactor* reactor)
+{
+    Connection* conn = connections.add(client_fd, reactor, next_connection_id);
+    if (!conn)
+        return 0;
 
-    struct epoll_event event;
-    event.events = EPOLLIN;
-    event.data.fd = client_fd;
-    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &event) < 0)
+    struct sockaddr_storage peer;
+    socklen_t peer_len = sizeof(peer);
+    if (getpeername(client_fd, reinterpret_cast<struct sockaddr*>(&peer), &peer_len) == 0)
 	{
-        std::cerr << "Error adding client socket to epoll: " << strerror(errno) << std::endl;
-        close(client_fd);
-        return;
+        conn->user.setHostname(Resolver::numericHost(peer, peer_len));
+        resolver.resolve(client_fd, conn->id, peer, peer_len);
     }
-
-    std::cout << "New connection accepted! Client fd: " << client_fd << std::endl;
-
-    users[client_fd] = User();
-    client_buffers[client_fd] = "";
+    clients_metric.add(1);
+    return next_connection_id++;
 }
 
-void Server::handleClientData(int client_fd)
+void Server::sendToClient(int client_fd, const std::string& message)
 {
-    char buffer[1024];
-    memset(buffer, 0, sizeof(buffer));
-    int bytes_received = recv(client_fd, buffer, sizeof(buffer) - 1, 0);
-
-    if (bytes_received <= 0)
-	{
-        if (bytes_received == 0)
-            std::cout << "Client disconnected (fd: " << client_fd << ")" << std::endl;
-        else
-            std::cerr << "Error receiving data: " << strerror(errno) << std::endl;
+    sendToClient(client_fd, StringView(message));
+}
 
-        disconnectClient(client_fd);
+// Copied into the client's queue when its reactor is the current thread, so
+// only a reply posted to another reactor is put in a buffer of its own.
+void Server::sendToClient(int client_fd, const StringView& message)
+{
+    Connection* conn = connections.find(client_fd);
+    if (!conn)
         return;
-    }
 
-    client_buffers[client_fd] += buffer;
+    Reactor* owner = conn->reactor;
+    Reactor* current = Reactor::current();
 
-    std::string& buf = client_buffers[client_fd];
-    size_t pos;
-    while ((pos = buf.find("\r\n")) != std::string::npos)
-	{
-        std::string line = buf.substr(0, pos);
-        buf = buf.substr(pos + 2);
+    if (current == NULL || current == owner)
+        owner->queueOutput(client_fd, message);
+    else
+        current->post(*owner, client_fd, conn->id, SharedBuffer(message.data(), message.size()));
+}
 
-        std::cout << "Received from client " << client_fd << ": " << line << std::endl;
+void Server::sendToClient(int client_fd, const SharedBuffer& message)
+{
+    Connection* conn = connections.find(client_fd);
+    if (!conn)
+        return;
 
-        processCommand(client_fd, line);
-    }
+    Reactor* owner = conn->reactor;
+    Reactor* current = Reactor::current();
+
+    if (current == NULL || current == owner)
+        owner->queueOutput(client_fd, message);
+    else
+        current->post(*owner, client_fd, conn->id, message);
 }
 
-void Server::disconnectClient(int client_fd)
+void Server::disconnectClient(int client_fd, const std::string& reason)
 {
-    if (users.find(client_fd) == users.end())
+    Connection* conn = connections.find(client_fd);
+    if (!conn)
         return;
 
-    if (!users[client_fd].getNickname().empty())
+    User& user = conn->user;
+    if (user.hasNickname())
 	{
-        std::string quit_notification = ":" + users[client_fd].getFullIdentity() + " QUIT :Connection closed\r\n";
-
-        std::vector<std::string> userChannels;
-        for (std::map<std::string, Channel>::iterator channel_it = channels.begin();
-             channel_it != channels.end();
-             ++channel_it) {
-            if (channel_it->second.hasMember(client_fd))
-                userChannels.push_back(channel_it->first);
-        }
+        SharedBuffer quit_notification(":" + user.getFullIdentity() + " QUIT :" + reason + "\r\n");
 
-        for (size_t i = 0; i < userChannels.size(); ++i)
+        const std::vector<unsigned int>& joined = user.getChannels();
+        for (size_t i = 0; i < joined.size(); ++i)
 		{
-            std::map<std::string, Channel>::iterator channel_it = channels.find(userChannels[i]);
-            if (channel_it != channels.end())
+            Channel* channel = channels.get(joined[i]);
+            if (!channel)
+                continue;
+
+            int newOp = channel->operatorSuccessor(client_fd);
+            if (newOp != -1 && connections.contains(newOp))
 			{
-                if (channel_it->second.isOperator(client_fd))
-				{
-                    int remainingOps = 0;
-                    const std::set<int>& ops = channel_it->second.getOperators();
-                    for (std::set<int>::const_iterator op_it = ops.begin(); op_it != ops.end(); ++op_it)
-					{
-                        if (*op_it != client_fd)
-                            remainingOps++;
-                    }
-
-                    if (remainingOps == 0 && channel_it->second.getMembers().size() > 1)
-					{
-                        int newOp = -1;
-                        const std::set<int>& members = channel_it->second.getMembers();
-                        for (std::set<int>::const_iterator mem_it = members.begin(); mem_it != members.end(); ++mem_it)
-						{
-                            if (*mem_it != client_fd)
-							{
-                                newOp = *mem_it;
-                                break;
-                            }
-                        }
-                        if (newOp != -1 && users.find(newOp) != users.end())
-						{
-                            channel_it->second.addOperator(newOp);
-                            std::string mode_msg = ":ircserv MODE " + userChannels[i] + " +o " + users[newOp].getNickname() + "\r\n";
-                            channel_it->second.broadcastMessage(mode_msg);
-                        }
-                    }
-                }
-
-                channel_it->second.broadcastMessage(quit_notification, client_fd);
-                channel_it->second.removeMember(client_fd);
-
-                if (channel_it->second.isEmpty())
-                    channels.erase(channel_it);
+                channel->addOperator(newOp);
+                std::string mode_msg = ":" + config.server_name + " MODE " + channel->getName() + " +o " + nicks.name(connections.user(newOp).getNick()) + "\r\n";
+                channel->broadcastMessage(*this, mode_msg);
             }
+
+            channel->broadcastMessage(*this, quit_notification, client_fd);
+            channel->removeMember(client_fd);
+
+            if (channel->isEmpty())
+                channels.erase(joined[i]);
         }
     }
 
-    client_buffers.erase(client_fd);
-    users.erase(client_fd);
+    nicks.remove(user.getNick(), client_fd);
+    clients_metric.add(-1);
+    disconnects_metric.add();
+    conn->reactor->closeConnection(client_fd);
+}
 
-    if (client_fd > 0) {
-        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client_fd, NULL);
-        close(client_fd);
-    }
+bool Server::isSharedCommand(const StringView& line) const
+{
+    return command_handlers[0]->isShared(line);
 }
 
-void Server::processCommand(int client_fd, const std::string& line)
+void Server::processCommand(int client_fd, const StringView& line)
 {
-    command_handler->process(client_fd, line);
+    Reactor* current = Reactor::current();
+    command_handlers[current ? current->getIndex() : 0]->process(client_fd, line);
 }
 
-void Server::run()
+void Server::rejectLongLine(int client_fd)
+{
+    Reactor* current = Reactor::current();
+    command_handlers[current ? current->getIndex() : 0]->replyInputTooLong(client_fd);
+}
+
+// A client that registered before the lookup finished keeps the numeric
+// address: its prefix has been sent out already and must not change.
+void Server::updateHostname(int client_fd, unsigned long id, const std::string& hostname)
+{
+    Connection* conn = connections.find(client_fd);
+    if (conn && conn->id == id && !conn->user.isAuthenticated())
+        conn->user.setHostname(hostname);
+}
+
+bool Server::fanOut(const Channel& channel, const SharedBuffer& message, int exclude_fd)
 {
-    setupSocket();
+    Reactor* current = Reactor::current();
+    if (!current || !fanout_pool.isRunning() || channel.getMemberCount() < static_cast<size_t>(config.fanout_threshold))
+        return false;
+
+    if (!current->fanOut(fanout_pool, channel.getMembers(), message, exclude_fd))
+        return false;
+    fanouts_metric.add();
+    return true;
+}
 
-    if (server_fd < 0 || epoll_fd < 0)
+void Server::refreshMetrics()
+{
+    size_t largest = 0;
+    for (ChannelTable::Id id = 0; id < channels.bound(); ++id)
 	{
-        std::cerr << "Server setup failed. Exiting." << std::endl;
-        return;
+        const Channel* channel = channels.get(id);
+        if (channel)
+            largest = std::max(largest, channel->getMemberCount());
     }
 
-    const int MAX_EVENTS = 10;
-    struct epoll_event events[MAX_EVENTS];
+    channels_metric.set(static_cast<long>(channels.size()));
+    largest_channel_metric.set(static_cast<long>(largest));
+}
 
+void Server::run()
+{
+    size_t count = static_cast<size_t>(config.threads);
 
-    while (running)
+    for (size_t i = 0; i < count; ++i)
 	{
-        int n_events = epoll_wait(epoll_fd, events, MAX_EVENTS, 100);
+        reactors.push_back(new Reactor(*this, config, i, count));
+        if (!reactors[i]->setup(count > 1))
+		{
+            std::cerr << "Server setup failed. Exiting." << std::endl;
+            cleanupResources();
+            return;
+        }
+    }
 
-        if (n_events < 0) {
-            if (errno == EINTR)
-                continue;
+    std::cout << "Server started on port " << config.port;
+    if (count > 1)
+        std::cout << " with " << count << " reactor threads";
+    std::cout << std::endl;
+    std::cout << "Waiting for connections..." << std::endl;
 
-            std::cerr << "Error in epoll_wait: " << strerror(errno) << std::endl;
-            break;
-        }
+    if (config.resolve_hosts)
+        resolver.start();
+    if (config.metrics_port != 0)
+        metrics_endpoint.start(config.metrics_port);
+    if (config.fanout_threads > 0)
+        fanout_pool.start(static_cast<size_t>(config.fanout_threads));
 
-        for (int i = 0; i < n_events; i++)
+    for (size_t i = 1; i < count; ++i)
+	{
+        if (!reactors[i]->start())
 		{
-            if (events[i].data.fd == server_fd)
-                handleNewConnection();
-            else
-                handleClientData(events[i].data.fd);
+            running = 0;
+            break;
         }
     }
 
-	std::cout << "Cleaning up resources before quitting..." << std::endl;
+    reactors[0]->run();
+
+    for (size_t i = 1; i < count; ++i)
+        reactors[i]->join();
+
+    std::cout << "Cleaning up resources before quitting..." << std::endl;
+    for (size_t i = 0; i < count; ++i)
+        reactors[i]->printAcceptStats();
     cleanupResources();
 }
@@ -0,0 +1,203 @@
+#include <ServerConfig.hpp>
+#include <iostream>
+#include <cstdlib>
+#include <climits>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// One worker per spare core, up to 4; none on a single core.
+static int defaultFanoutThreads()
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores <= 1)
+        return 0;
+    return cores - 1 < 4 ? static_cast<int>(cores - 1) : 4;
+}
+
+ServerConfig::ServerConfig()
+    : port(0), backlog(SOMAXCONN), max_events(64), accept_batch(true), threads(1), read_size(16384), io_backend("epoll"),
+      resolve_hosts(true), log_level(LOG_INFO), metrics_port(0), flood_command_rate(10), flood_command_burst(20),
+      flood_byte_rate(8192), flood_byte_burst(16384), flood_timeout(10), ping_interval(120), ping_timeout(60),
+      registration_timeout(30), fanout_threads(defaultFanoutThreads()), fanout_threshold(4096),
+      server_name("ircserv"), network_name("IRC") {}
+
+static bool parsePositive(const std::string& value, int& out)
+{
+    if (value.empty())
+        return false;
+
+    char *end = NULL;
+    long parsed = std::strtol(value.c_str(), &end, 10);
+    if (*end != '\0' || parsed <= 0 || parsed > INT_MAX)
+        return false;
+
+    out = static_cast<int>(parsed);
+    return true;
+}
+
+// A name sent as a single IRC parameter: non-empty, without spaces, and not
+// starting with ':'.
+static bool parseName(const std::string& value, std::string& out)
+{
+    if (value.empty() || value[0] == ':' || value.find_first_of(" \r\n") != std::string::npos)
+        return false;
+
+    out = value;
+    return true;
+}
+
+// RATE:BURST, both positive.
+static bool parseRate(const std::string& value, int& rate, int& burst)
+{
+    size_t colon = value.find(':');
+    if (colon == std::string::npos)
+        return false;
+    return parsePositive(value.substr(0, colon), rate) && parsePositive(value.substr(colon + 1), burst);
+}
+
+static bool parseOption(const std::string& arg, ServerConfig& config)
+{
+    size_t eq = arg.find('=');
+    std::string name = arg.substr(0, eq);
+    std::string value = (eq == std::string::npos) ? "" : arg.substr(eq + 1);
+
+    if (name == "--backlog")
+        return parsePositive(value, config.backlog);
+    if (name == "--max-events")
+        return parsePositive(value, config.max_events);
+    if (name == "--threads")
+        return parsePositive(value, config.threads);
+    if (name == "--read-size")
+        return parsePositive(value, config.read_size);
+    if (name == "--io")
+	{
+        if (value != "epoll" && value != "io_uring")
+            return false;
+        config.io_backend = value;
+        return true;
+    }
+    if (name == "--log-level")
+        return Logger::parseLevel(value, config.log_level);
+    if (name == "--log-file")
+	{
+        if (value.empty())
+            return false;
+        config.log_file = value;
+        return true;
+    }
+    if (name == "--oper")
+	{
+        size_t colon = value.find(':');
+        if (colon == std::string::npos || colon == 0 || colon + 1 == value.size())
+            return false;
+        config.oper_name = value.substr(0, colon);
+        config.oper_password = value.substr(colon + 1);
+        return true;
+    }
+    if (name == "--metrics-port")
+        return parsePositive(value, config.metrics_port) && config.metrics_port <= 65535;
+    if (name == "--flood")
+	{
+        if (value == "off")
+		{
+            config.flood_command_rate = 0;
+            return true;
+        }
+        return parseRate(value, config.flood_command_rate, config.flood_command_burst);
+    }
+    if (name == "--flood-bytes")
+        return parseRate(value, config.flood_byte_rate, config.flood_byte_burst);
+    if (name == "--flood-timeout")
+        return parsePositive(value, config.flood_timeout);
+    if (name == "--ping-interval")
+        return parsePositive(value, config.ping_interval);
+    if (name == "--ping-timeout")
+        return parsePositive(value, config.ping_timeout);
+    if (name == "--registration-timeout")
+        return parsePositive(value, config.registration_timeout);
+    if (name == "--fanout-threads")
+	{
+        if (value == "off")
+		{
+            config.fanout_threads = 0;
+            return true;
+        }
+        return parsePositive(value, config.fanout_threads) && config.fanout_threads <= 64;
+    }
+    if (name == "--fanout-threshold")
+        return parsePositive(value, config.fanout_threshold);
+    if (name == "--server-name")
+        return parseName(value, config.server_name);
+    if (name == "--network-name")
+        return parseName(value, config.network_name);
+    if (name == "--dns")
+	{
+        if (value == "on")
+            config.resolve_hosts = true;
+        else if (value == "off")
+            config.resolve_hosts = false;
+        else
+            return false;
+        return true;
+    }
+    if (name == "--accept")
+	{
+        if (value == "batch")
+            config.accept_batch = true;
+        else if (value == "single")
+            config.accept_batch = false;
+        else
+            return false;
+        return true;
+    }
+    return false;
+}
+
+bool parseServerConfig(int argc, char **argv, ServerConfig& config)
+{
+    if (argc < 3)
+        return false;
+
+    if (!parsePositive(argv[1], config.port) || config.port > 65535)
+	{
+        std::cerr << "Invalid port: " << argv[1] << std::endl;
+        return false;
+    }
+    config.password = argv[2];
+
+    for (int i = 3; i < argc; ++i)
+	{
+        if (!parseOption(argv[i], config))
+		{
+            std::cerr << "Invalid option: " << argv[i] << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void printServerUsage(const char *program)
+{
+    std::cerr << "Usage: " << program << " <port> <password> [options]" << std::endl
+              << "  --backlog=N              listen() backlog (default: SOMAXCONN)" << std::endl
+              << "  --max-events=N           events fetched per epoll_wait (default: 64)" << std::endl
+              << "  --accept=batch|single    drain the listen socket on each wakeup, or accept one connection (default: batch)" << std::endl
+              << "  --threads=N              reactor threads, each with its own SO_REUSEPORT listener (default: 1)" << std::endl
+              << "  --read-size=N            bytes read from a client socket per recv (default: 16384)" << std::endl
+              << "  --io=epoll|io_uring      I/O backend; io_uring falls back to epoll when unsupported (default: epoll)" << std::endl
+              << "  --dns=on|off             reverse-resolve client hostnames in the background (default: on)" << std::endl
+              << "  --log-level=LEVEL        off, error, info, debug or trace; trace logs every received line (default: info)" << std::endl
+              << "  --log-file=PATH          append the log to PATH instead of stderr" << std::endl
+              << "  --oper=NAME:PASSWORD     credentials accepted by OPER, which unlocks STATS (default: none)" << std::endl
+              << "  --metrics-port=N         serve Prometheus metrics on 127.0.0.1:N/metrics (default: off)" << std::endl
+              << "  --flood=RATE:BURST|off   command tokens refilled per second and bucket size per client (default: 10:20)" << std::endl
+              << "  --flood-bytes=RATE:BURST input bytes refilled per second and bucket size per client (default: 8192:16384)" << std::endl
+              << "  --flood-timeout=SECONDS  disconnect a client still over budget after this long throttled (default: 10)" << std::endl
+              << "  --ping-interval=SECONDS  send PING to a client idle for this long (default: 120)" << std::endl
+              << "  --ping-timeout=SECONDS   disconnect a client that sends nothing this long after a PING (default: 60)" << std::endl
+              << "  --registration-timeout=SECONDS  disconnect a client not registered this long after connecting (default: 30)" << std::endl
+              << "  --fanout-threads=N|off   worker threads sharing broadcasts to large channels (default: spare cores, up to 4)" << std::endl
+              << "  --fanout-threshold=N     members from which a channel broadcast is split across them (default: 4096)" << std::endl
+              << "  --server-name=NAME       name the server gives itself in replies (default: ircserv)" << std::endl
+              << "  --network-name=NAME      network named in the welcome and 005 replies (default: IRC)" << std::endl;
+}
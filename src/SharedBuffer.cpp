@@ -0,0 +1,93 @@
+#include <SharedBuffer.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+SharedBuffer::SharedBuffer() : block(NULL) {}
+
+SharedBuffer::SharedBuffer(const std::string& data) : block(NULL)
+{
+    assign(data.data(), data.length(), data.length());
+}
+
+SharedBuffer::SharedBuffer(const char* data, size_t length) : block(NULL)
+{
+    assign(data, length, length);
+}
+
+SharedBuffer::SharedBuffer(const char* data, size_t length, size_t capacity) : block(NULL)
+{
+    assign(data, length, capacity < length ? length : capacity);
+}
+
+SharedBuffer::SharedBuffer(const SharedBuffer& other) : block(other.block)
+{
+    if (block)
+        __sync_fetch_and_add(&block->refs, 1);
+}
+
+SharedBuffer& SharedBuffer::operator=(const SharedBuffer& other)
+{
+    if (block != other.block)
+	{
+        if (other.block)
+            __sync_fetch_and_add(&other.block->refs, 1);
+        release();
+        block = other.block;
+    }
+    return *this;
+}
+
+SharedBuffer::~SharedBuffer()
+{
+    release();
+}
+
+void SharedBuffer::assign(const char* data, size_t length, size_t capacity)
+{
+    if (length == 0)
+        return;
+
+    block = static_cast<Block*>(std::malloc(offsetof(Block, data) + capacity));
+    if (!block)
+        throw std::bad_alloc();
+
+    block->refs = 1;
+    block->length = length;
+    block->capacity = capacity;
+    std::memcpy(block->data, data, length);
+}
+
+void SharedBuffer::release()
+{
+    if (block && __sync_sub_and_fetch(&block->refs, 1) == 0)
+        std::free(block);
+    block = NULL;
+}
+
+const char* SharedBuffer::data() const
+{
+    return block ? block->data : "";
+}
+
+size_t SharedBuffer::size() const
+{
+    return block ? block->length : 0;
+}
+
+bool SharedBuffer::empty() const
+{
+    return block == NULL;
+}
+
+bool SharedBuffer::append(const char* data, size_t length)
+{
+    if (!block || __atomic_load_n(&block->refs, __ATOMIC_ACQUIRE) != 1)
+        return false;
+    if (block->capacity - block->length < length)
+        return false;
+
+    std::memcpy(block->data + block->length, data, length);
+    block->length += length;
+    return true;
+}
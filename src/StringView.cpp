@@ -0,0 +1,6 @@
+#include <StringView.hpp>
+
+std::string StringView::str() const
+{
+    return std::string(ptr, len);
+}
@@ -0,0 +1,240 @@
+#include <TimerWheel.hpp>
+#include <Logger.hpp>
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+static void unlink(TimerWheel::Timer& timer)
+{
+    timer.prev->next = timer.next;
+    timer.next->prev = timer.prev;
+    timer.prev = NULL;
+    timer.next = NULL;
+}
+
+static void linkBefore(TimerWheel::Timer& head, TimerWheel::Timer& timer)
+{
+    timer.next = &head;
+    timer.prev = head.prev;
+    head.prev->next = &timer;
+    head.prev = &timer;
+}
+
+static bool isEmpty(const TimerWheel::Timer& head)
+{
+    return head.next == &head;
+}
+
+TimerWheel::Timer::Timer() : prev(NULL), next(NULL), expires(0), bucket(0), fd(-1) {}
+
+TimerWheel::TimerWheel() : current(0), armed(0), timer_fd(-1)
+{
+    for (unsigned int i = 0; i < LEVELS * SLOTS; ++i)
+        buckets[i].prev = buckets[i].next = &buckets[i];
+    expired.prev = expired.next = &expired;
+    for (unsigned int i = 0; i < LEVELS; ++i)
+        occupied[i] = 0;
+    clock_gettime(CLOCK_MONOTONIC, &origin);
+}
+
+TimerWheel::~TimerWheel()
+{
+    if (timer_fd >= 0)
+        close(timer_fd);
+}
+
+bool TimerWheel::setup()
+{
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0)
+	{
+        std::cerr << "Error creating timerfd: " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int TimerWheel::getFd() const
+{
+    return timer_fd;
+}
+
+unsigned long TimerWheel::now() const
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long ms = (now.tv_sec - origin.tv_sec) * 1000L + (now.tv_nsec - origin.tv_nsec) / 1000000;
+    return static_cast<unsigned long>(ms / TICK_MS);
+}
+
+// Level n holds the timers due in [SLOTS^n, SLOTS^(n+1)) ticks; the slot is
+// picked from the expiry itself, so it comes round exactly when the timer
+// has less than one slot of level n left to wait.
+void TimerWheel::insert(Timer& timer)
+{
+    unsigned long delta = timer.expires - current;
+    unsigned int level = 0;
+    while (level + 1 < LEVELS && delta >= (1UL << (SLOT_BITS * (level + 1))))
+        ++level;
+
+    unsigned int slot = (timer.expires >> (SLOT_BITS * level)) & (SLOTS - 1);
+    timer.bucket = level * SLOTS + slot;
+    linkBefore(buckets[timer.bucket], timer);
+    occupied[level] |= static_cast<uint64_t>(1) << slot;
+}
+
+void TimerWheel::schedule(Timer& timer, long delay_ms)
+{
+    if (timer.isPending())
+        cancel(timer);
+
+    // An empty wheel is not advanced; it starts counting again from now.
+    unsigned long base = now();
+    if (base < current)
+        base = current;
+    else if (nextEvent() == 0)
+        current = base;
+
+    unsigned long ticks = (delay_ms + TICK_MS - 1) / TICK_MS;
+    if (ticks == 0)
+        ticks = 1;
+    unsigned long horizon = 1UL << (SLOT_BITS * LEVELS);
+    timer.expires = base + ticks;
+    if (timer.expires - current >= horizon)
+        timer.expires = current + horizon - 1;
+
+    insert(timer);
+    if (armed == 0 || timer.expires < armed)
+        rearm();
+}
+
+void TimerWheel::cancel(Timer& timer)
+{
+    if (!timer.isPending())
+        return;
+
+    unsigned int bucket = timer.bucket;
+    unlink(timer);
+    if (bucket != EXPIRED && isEmpty(buckets[bucket]))
+        occupied[bucket / SLOTS] &= ~(static_cast<uint64_t>(1) << (bucket % SLOTS));
+}
+
+void TimerWheel::cascade(unsigned int level)
+{
+    unsigned int slot = (current >> (SLOT_BITS * level)) & (SLOTS - 1);
+    Timer& head = buckets[level * SLOTS + slot];
+    occupied[level] &= ~(static_cast<uint64_t>(1) << slot);
+
+    while (!isEmpty(head))
+	{
+        Timer& timer = *head.next;
+        unlink(timer);
+        insert(timer);
+    }
+}
+
+unsigned long TimerWheel::nextEvent() const
+{
+    unsigned long next = 0;
+
+    for (unsigned int level = 0; level < LEVELS; ++level)
+	{
+        uint64_t bits = occupied[level];
+        if (bits == 0)
+            continue;
+
+        // Rotate so that bit 0 is the slot after the current one.
+        unsigned int shift = SLOT_BITS * level;
+        unsigned int start = ((current >> shift) + 1) & (SLOTS - 1);
+        if (start != 0)
+            bits = (bits >> start) | (bits << (SLOTS - start));
+
+        unsigned long distance = __builtin_ctzll(bits) + 1;
+        unsigned long tick = ((current >> shift) + distance) << shift;
+        if (next == 0 || tick < next)
+            next = tick;
+    }
+    return next;
+}
+
+void TimerWheel::advance()
+{
+    uint64_t expirations;
+    while (read(timer_fd, &expirations, sizeof(expirations)) > 0)
+        ;
+    armed = 0;
+
+    unsigned long target = now();
+    while (current < target)
+	{
+        unsigned long next = nextEvent();
+        if (next == 0 || next > target)
+		{
+            current = target;
+            break;
+        }
+
+        // Nothing is due and no slot comes round between here and next.
+        current = next;
+        for (unsigned int level = 1; level < LEVELS; ++level)
+		{
+            if (current & ((1UL << (SLOT_BITS * level)) - 1))
+                break;
+            cascade(level);
+        }
+
+        unsigned int slot = current & (SLOTS - 1);
+        Timer& head = buckets[slot];
+        occupied[0] &= ~(static_cast<uint64_t>(1) << slot);
+        while (!isEmpty(head))
+		{
+            Timer& timer = *head.next;
+            unlink(timer);
+            timer.bucket = EXPIRED;
+            linkBefore(expired, timer);
+        }
+    }
+}
+
+TimerWheel::Timer* TimerWheel::popExpired()
+{
+    if (isEmpty(expired))
+        return NULL;
+
+    Timer* timer = expired.next;
+    unlink(*timer);
+    return timer;
+}
+
+void TimerWheel::arm(unsigned long tick)
+{
+    struct itimerspec spec;
+    std::memset(&spec, 0, sizeof(spec));
+    if (tick != 0)
+	{
+        long ms = static_cast<long>(tick) * TICK_MS;
+        spec.it_value.tv_sec = origin.tv_sec + ms / 1000;
+        spec.it_value.tv_nsec = origin.tv_nsec + (ms % 1000) * 1000000L;
+        if (spec.it_value.tv_nsec >= 1000000000L)
+		{
+            spec.it_value.tv_sec++;
+            spec.it_value.tv_nsec -= 1000000000L;
+        }
+    }
+
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0)
+        LogLine(LOG_ERROR) << "Error arming timerfd: " << strerror(errno);
+    armed = tick;
+}
+
+void TimerWheel::rearm()
+{
+    if (timer_fd < 0)
+        return;
+
+    unsigned long next = nextEvent();
+    if (next != armed)
+        arm(next);
+}
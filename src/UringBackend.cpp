@@ -0,0 +1,529 @@
+#include <UringBackend.hpp>
+#include <Logger.hpp>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/time_types.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <cstring>
+#include <cerrno>
+#include <stdint.h>
+
+UringBackend::UringBackend(const ServerConfig& config)
+    : config(config), ring_fd(-1), listen_fd(-1), ring_map(MAP_FAILED), ring_map_size(0),
+      sqes(static_cast<struct io_uring_sqe*>(MAP_FAILED)), sqes_size(0), sq_head(NULL), sq_tail(NULL),
+      sq_array(NULL), sq_mask(0), sq_entries(0), sq_local_tail(0), cq_head(NULL), cq_tail(NULL),
+      cq_mask(0), cqes(NULL), buf_ring(static_cast<struct io_uring_buf_ring*>(MAP_FAILED)),
+      buf_ring_size(0), buffers(NULL), buf_tail(0), accept_retry(false), accept_stalled(false) {}
+
+UringBackend::~UringBackend()
+{
+    if (ring_fd >= 0)
+        ::close(ring_fd);
+    if (ring_map != MAP_FAILED)
+        munmap(ring_map, ring_map_size);
+    if (sqes != MAP_FAILED)
+        munmap(sqes, sqes_size);
+    if (buf_ring != MAP_FAILED)
+        munmap(buf_ring, buf_ring_size);
+    delete[] buffers;
+
+    for (std::set<SendOp*>::iterator it = in_flight.begin(); it != in_flight.end(); ++it)
+        delete *it;
+}
+
+const char* UringBackend::name() const
+{
+    return "io_uring";
+}
+
+unsigned long long UringBackend::encode(OpType type, unsigned int generation, int fd)
+{
+    return (static_cast<unsigned long long>(fd) << 32)
+        | (static_cast<unsigned long long>(generation & 0xffffff) << 8) | type;
+}
+
+bool UringBackend::setupRing()
+{
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = RING_ENTRIES * 8;
+
+    ring_fd = syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+    if (ring_fd < 0)
+	{
+        std::cerr << "io_uring_setup failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+    if ((params.features & required) != required)
+	{
+        std::cerr << "io_uring lacks required features" << std::endl;
+        return false;
+    }
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring_map_size = sq_size > cq_size ? sq_size : cq_size;
+
+    ring_map = mmap(NULL, ring_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring_fd, IORING_OFF_SQ_RING);
+    if (ring_map == MAP_FAILED)
+	{
+        std::cerr << "io_uring ring mmap failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes = static_cast<struct io_uring_sqe*>(mmap(NULL, sqes_size, PROT_READ | PROT_WRITE,
+                                                  MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES));
+    if (sqes == MAP_FAILED)
+	{
+        std::cerr << "io_uring sqe mmap failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    char* base = static_cast<char*>(ring_map);
+    sq_head = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+    sq_array = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+    sq_mask = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+    sq_entries = params.sq_entries;
+    sq_local_tail = *sq_tail;
+
+    cq_head = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+    cq_mask = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<struct io_uring_cqe*>(base + params.cq_off.cqes);
+    return true;
+}
+
+bool UringBackend::setupBuffers()
+{
+    buf_ring_size = BUFFER_COUNT * sizeof(struct io_uring_buf);
+    buf_ring = static_cast<struct io_uring_buf_ring*>(mmap(NULL, buf_ring_size, PROT_READ | PROT_WRITE,
+                                                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (buf_ring == MAP_FAILED)
+	{
+        std::cerr << "io_uring buffer ring mmap failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uintptr_t>(buf_ring);
+    reg.ring_entries = BUFFER_COUNT;
+    reg.bgid = 0;
+
+    if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+	{
+        std::cerr << "io_uring provided buffer ring unavailable: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    buffers = new char[BUFFER_COUNT * static_cast<size_t>(config.read_size)];
+    for (unsigned short bid = 0; bid < BUFFER_COUNT; ++bid)
+        recycleBuffer(bid);
+    return true;
+}
+
+bool UringBackend::setup(int fd)
+{
+    listen_fd = fd;
+
+    if (!setupRing() || !setupBuffers())
+        return false;
+
+    // io_uring waits for readiness itself; blocking sockets keep it from
+    // surfacing EAGAIN to us. Direct flushes still pass MSG_DONTWAIT.
+    int flags = fcntl(listen_fd, F_GETFL);
+    if (flags < 0 || fcntl(listen_fd, F_SETFL, flags & ~O_NONBLOCK) < 0)
+        return false;
+
+    armAccept();
+    return enter(0, 0);
+}
+
+struct io_uring_sqe* UringBackend::getSqe()
+{
+    if (sq_local_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries)
+	{
+        enter(0, 0);
+        if (sq_local_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries)
+            return NULL;
+    }
+
+    unsigned index = sq_local_tail & sq_mask;
+    struct io_uring_sqe* sqe = &sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sq_array[index] = index;
+    sq_local_tail++;
+    return sqe;
+}
+
+bool UringBackend::enter(unsigned int wait_nr, int timeout_ms)
+{
+    __atomic_store_n(sq_tail, sq_local_tail, __ATOMIC_RELEASE);
+    unsigned to_submit = sq_local_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+
+    unsigned flags = 0;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    void* argp = NULL;
+    size_t argsz = 0;
+
+    if (wait_nr > 0)
+	{
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+        std::memset(&arg, 0, sizeof(arg));
+        arg.sigmask_sz = _NSIG / 8;
+        // A negative timeout waits until a completion arrives.
+        arg.ts = timeout_ms < 0 ? 0 : reinterpret_cast<uintptr_t>(&ts);
+        argp = &arg;
+        argsz = sizeof(arg);
+        flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    }
+    else if (to_submit == 0)
+        return true;
+
+    if (syscall(__NR_io_uring_enter, ring_fd, to_submit, wait_nr, flags, argp, argsz) < 0)
+	{
+        if (errno == ETIME || errno == EINTR || errno == EAGAIN || errno == EBUSY)
+            return true;
+        LogLine(LOG_ERROR) << "io_uring_enter failed: " << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void UringBackend::armAccept()
+{
+    struct io_uring_sqe* sqe = getSqe();
+    if (!sqe)
+	{
+        accept_retry = true;
+        return;
+    }
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = encode(OP_ACCEPT, 0, listen_fd);
+    accept_retry = false;
+}
+
+void UringBackend::armRecv(int client_fd)
+{
+    struct io_uring_sqe* sqe = getSqe();
+    if (!sqe)
+        return;
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = client_fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = 0;
+    sqe->user_data = encode(OP_RECV, slots[client_fd].generation, client_fd);
+}
+
+void UringBackend::armWatch(int fd)
+{
+    struct io_uring_sqe* sqe = getSqe();
+    if (!sqe)
+        return;
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = encode(OP_WATCH, 0, fd);
+}
+
+void UringBackend::cancel(unsigned long long user_data)
+{
+    struct io_uring_sqe* sqe = getSqe();
+    if (!sqe)
+        return;
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = user_data;
+    sqe->user_data = encode(OP_CANCEL, 0, 0);
+}
+
+void UringBackend::recycleBuffer(unsigned short bid)
+{
+    // Index the entries by hand: in C++ the header's flexible bufs[] member sits
+    // 8 bytes past the start of the ring instead of overlaying the tail.
+    struct io_uring_buf* buf = reinterpret_cast<struct io_uring_buf*>(buf_ring) + (buf_tail & (BUFFER_COUNT - 1));
+    buf->addr = reinterpret_cast<uintptr_t>(buffers + static_cast<size_t>(bid) * config.read_size);
+    buf->len = config.read_size;
+    buf->bid = bid;
+    buf_tail++;
+    __atomic_store_n(&buf_ring->tail, buf_tail, __ATOMIC_RELEASE);
+}
+
+bool UringBackend::watch(int fd)
+{
+    armWatch(fd);
+    return enter(0, 0);
+}
+
+bool UringBackend::addClient(int client_fd)
+{
+    int flags = fcntl(client_fd, F_GETFL);
+    if (flags >= 0 && (flags & O_NONBLOCK))
+        fcntl(client_fd, F_SETFL, flags & ~O_NONBLOCK);
+
+    if (static_cast<size_t>(client_fd) >= slots.size())
+	{
+        Slot empty = { 0, false, false, NULL };
+        slots.resize(client_fd + 1, empty);
+    }
+
+    Slot& slot = slots[client_fd];
+    slot.generation++;
+    slot.active = true;
+    slot.reading = true;
+    slot.send = NULL;
+
+    armRecv(client_fd);
+    return true;
+}
+
+bool UringBackend::send(int client_fd, OutputQueue& queue)
+{
+    Slot& slot = slots[client_fd];
+    if (slot.send || queue.empty())
+        return true;
+
+    // Most writes fit in the socket buffer; only the remainder waits in the ring.
+    if (!queue.flush(client_fd))
+        return false;
+    if (queue.empty())
+        return true;
+
+    struct io_uring_sqe* sqe = getSqe();
+    if (!sqe)
+        return true;
+
+    SendOp* op = new SendOp;
+    op->fd = client_fd;
+    op->queue = &queue;
+    std::memset(&op->msg, 0, sizeof(op->msg));
+    op->msg.msg_iov = op->iov;
+    op->msg.msg_iovlen = queue.prepare(op->iov, OutputQueue::MAX_IOV, &op->hold);
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = client_fd;
+    sqe->addr = reinterpret_cast<uintptr_t>(&op->msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = reinterpret_cast<uintptr_t>(op);
+
+    slot.send = op;
+    in_flight.insert(op);
+    return true;
+}
+
+void UringBackend::setReading(int client_fd, bool enabled)
+{
+    Slot& slot = slots[client_fd];
+    if (slot.reading == enabled)
+        return;
+
+    // Completions of the cancelled multishot recv that are already queued still arrive.
+    slot.reading = enabled;
+    if (enabled)
+        armRecv(client_fd);
+    else
+        cancel(encode(OP_RECV, slot.generation, client_fd));
+}
+
+void UringBackend::close(int client_fd, OutputQueue& queue, bool flush)
+{
+    Slot& slot = slots[client_fd];
+
+    if (slot.send)
+	{
+        // The operation keeps its own references to the buffers it writes.
+        slot.send->queue = NULL;
+        cancel(reinterpret_cast<uintptr_t>(slot.send));
+        slot.send = NULL;
+    }
+    else if (flush)
+        queue.flush(client_fd);
+
+    cancel(encode(OP_RECV, slot.generation, client_fd));
+    slot.active = false;
+    ::close(client_fd);
+
+    if (accept_retry)
+        armAccept();
+}
+
+void UringBackend::completeRecv(EventHandler& handler, const struct io_uring_cqe& cqe)
+{
+    int fd = static_cast<int>(cqe.user_data >> 32);
+    unsigned int generation = (cqe.user_data >> 8) & 0xffffff;
+    bool has_buffer = cqe.flags & IORING_CQE_F_BUFFER;
+    unsigned short bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+
+    if (static_cast<size_t>(fd) >= slots.size() || !slots[fd].active
+        || (slots[fd].generation & 0xffffff) != generation)
+	{
+        if (has_buffer)
+            recycleBuffer(bid);
+        return;
+    }
+
+    if (cqe.res > 0)
+	{
+        handler.onData(fd, buffers + static_cast<size_t>(bid) * config.read_size, cqe.res);
+        recycleBuffer(bid);
+
+        if (!(cqe.flags & IORING_CQE_F_MORE) && slots[fd].active && slots[fd].reading
+            && (slots[fd].generation & 0xffffff) == generation)
+            armRecv(fd);
+        return;
+    }
+
+    if (has_buffer)
+        recycleBuffer(bid);
+
+    if (cqe.res == 0)
+        handler.onHangup(fd, 0);
+    else if (cqe.res == -ENOBUFS)
+	{
+        if (slots[fd].reading)
+            armRecv(fd);
+    }
+    else if (cqe.res != -ECANCELED)
+        handler.onHangup(fd, -cqe.res);
+}
+
+void UringBackend::completeSend(EventHandler& handler, SendOp* op, int result)
+{
+    in_flight.erase(op);
+
+    OutputQueue* queue = op->queue;
+    int fd = op->fd;
+    delete op;
+
+    if (!queue)
+        return;
+
+    slots[fd].send = NULL;
+
+    if (result < 0)
+	{
+        handler.onHangup(fd, -result);
+        return;
+    }
+
+    queue->consume(result);
+    if (!queue->empty() && !send(fd, *queue))
+        handler.onHangup(fd, errno);
+}
+
+void UringBackend::handleCompletion(EventHandler& handler, const struct io_uring_cqe& cqe, int& accepted)
+{
+    OpType type = static_cast<OpType>(cqe.user_data & 7);
+
+    switch (type)
+	{
+        case OP_SEND:
+            completeSend(handler, reinterpret_cast<SendOp*>(static_cast<uintptr_t>(cqe.user_data)), cqe.res);
+            break;
+
+        case OP_ACCEPT:
+            if (cqe.res >= 0)
+			{
+                handler.onAccept(cqe.res);
+                accepted++;
+                accept_stalled = false;
+            }
+            else if (cqe.res == -EMFILE || cqe.res == -ENFILE)
+			{
+                // Logged once per shortage, not on every timed retry.
+                if (!accept_stalled)
+                    LogLine(LOG_ERROR) << "Error accepting connection: " << strerror(-cqe.res);
+                accept_stalled = true;
+            }
+            else if (cqe.res != -ECANCELED)
+                LogLine(LOG_ERROR) << "Error accepting connection: " << strerror(-cqe.res);
+
+            if (!(cqe.flags & IORING_CQE_F_MORE))
+			{
+                if (cqe.res == -EMFILE || cqe.res == -ENFILE)
+				{
+                    accept_retry = true;
+                    handler.onAcceptStalled();
+                }
+                else
+                    armAccept();
+            }
+            break;
+
+        case OP_RECV:
+            completeRecv(handler, cqe);
+            break;
+
+        case OP_WATCH:
+		{
+            int fd = static_cast<int>(cqe.user_data >> 32);
+            if (cqe.res >= 0)
+                handler.onWatch(fd);
+            if (!(cqe.flags & IORING_CQE_F_MORE) && cqe.res != -ECANCELED)
+                armWatch(fd);
+            break;
+        }
+
+        case OP_CANCEL:
+            break;
+    }
+}
+
+// The multishot accept ended on EMFILE; rearmed from the reactor's timer, as
+// an idle reactor may otherwise never get back here.
+void UringBackend::retryAccept(EventHandler&)
+{
+    if (accept_retry)
+        armAccept();
+}
+
+bool UringBackend::wait(EventHandler& handler, int timeout_ms)
+{
+    if (!enter(1, timeout_ms))
+        return false;
+
+    int accepted = 0;
+    int completions = 0;
+    unsigned head = *cq_head;
+    while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+	{
+        struct io_uring_cqe cqe = cqes[head & cq_mask];
+        head++;
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+
+        handleCompletion(handler, cqe, accepted);
+        completions++;
+    }
+
+    if (accepted > 0)
+        handler.onAcceptBatch(accepted);
+
+    // Out of descriptors: retry accepting once per idle period or when a client closes.
+    if (accept_retry && completions == 0)
+        armAccept();
+
+    // Everything queued while handling completions goes out in one submission.
+    return enter(0, 0);
+}
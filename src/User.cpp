@@ -1,13 +1,24 @@
 #include <User.hpp>
+#include <NickIndex.hpp>
+#include <algorithm>
 
-User::User() : authenticated(false), password_verified(false) {}
+User::User() : nick(NickIndex::NONE), hostname("localhost"), nick_length(0),
+    authenticated(false), password_verified(false), irc_operator(false)
+{
+    updateIdentity(StringView());
+}
 
 User::~User() {}
 
 // Getters
-const std::string& User::getNickname() const
+unsigned int User::getNick() const
+{
+    return nick;
+}
+
+bool User::hasNickname() const
 {
-    return nickname;
+    return nick != NickIndex::NONE;
 }
 
 const std::string& User::getUsername() const
@@ -20,6 +31,11 @@ const std::string& User::getRealname() const
     return realname;
 }
 
+const std::string& User::getHostname() const
+{
+    return hostname;
+}
+
 bool User::isAuthenticated() const
 {
     return authenticated;
@@ -30,14 +46,21 @@ bool User::isPasswordVerified() const
     return password_verified;
 }
 
-void User::setNickname(const std::string& nick)
+bool User::isIrcOperator() const
 {
-    nickname = nick;
+    return irc_operator;
+}
+
+void User::setNickname(unsigned int nick_id, const StringView& nickname)
+{
+    nick = nick_id;
+    updateIdentity(nickname);
 }
 
 void User::setUsername(const std::string& user)
 {
     username = user;
+    updateIdentity(identityNick());
 }
 
 void User::setRealname(const std::string& real)
@@ -45,6 +68,12 @@ void User::setRealname(const std::string& real)
     realname = real;
 }
 
+void User::setHostname(const std::string& host)
+{
+    hostname = host;
+    updateIdentity(identityNick());
+}
+
 void User::setAuthenticated(bool auth)
 {
     authenticated = auth;
@@ -55,7 +84,50 @@ void User::setPasswordVerified(bool verified)
     password_verified = verified;
 }
 
-std::string User::getFullIdentity() const
+void User::setIrcOperator(bool oper)
+{
+    irc_operator = oper;
+}
+
+void User::updateIdentity(const StringView& nickname)
+{
+    std::string updated;
+    updated.reserve(nickname.size() + username.size() + hostname.size() + 3);
+    updated.assign(nickname.data(), nickname.size());
+    updated.append("!~");
+    updated.append(username);
+    updated.append(1, '@');
+    updated.append(hostname);
+
+    identity.swap(updated);
+    nick_length = nickname.size();
+}
+
+StringView User::identityNick() const
+{
+    return StringView(identity.data(), nick_length);
+}
+
+const std::string& User::getFullIdentity() const
+{
+    return identity;
+}
+
+const std::vector<unsigned int>& User::getChannels() const
+{
+    return channels;
+}
+
+void User::addChannel(unsigned int channel_id)
+{
+    std::vector<unsigned int>::iterator it = std::lower_bound(channels.begin(), channels.end(), channel_id);
+    if (it == channels.end() || *it != channel_id)
+        channels.insert(it, channel_id);
+}
+
+void User::removeChannel(unsigned int channel_id)
 {
-    return nickname + "!~" + username + "@localhost";
+    std::vector<unsigned int>::iterator it = std::lower_bound(channels.begin(), channels.end(), channel_id);
+    if (it != channels.end() && *it == channel_id)
+        channels.erase(it);
 }
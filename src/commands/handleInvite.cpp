@@ -1,82 +1,68 @@
 #include <Command.hpp>
-#include <sys/socket.h>
+#include <Server.hpp>
 
-void Command::handleInvite(int client_fd, const std::string& line)
+void Command::handleInvite(int client_fd, const Message& msg)
 {
-    if (!users[client_fd].isAuthenticated())
+    User& user = connections.user(client_fd);
+
+    if (!user.isAuthenticated())
 	{
-        std::string error = ":ircserv 451 * :You have not registered\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NOTREGISTERED);
         return;
     }
 
-    std::istringstream iss;
-    if (line.length() > 7)
-        iss.str(line.substr(7));
-    std::string nickname, channel_name;
-
-    iss >> nickname >> channel_name;
+    const StringView& nickname = msg.param(0);
+    std::string channel_name = msg.param(1).str();
 
     if (nickname.empty() || channel_name.empty())
 	{
-        std::string error = ":ircserv 461 " + users[client_fd].getNickname() + " INVITE :Not enough parameters\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NEEDMOREPARAMS, StringView("INVITE", 6));
         return;
     }
 
     if (channel_name[0] != '#')
-        channel_name = "#" + channel_name;
+        channel_name.insert(0, 1, '#');
 
-    std::map<std::string, Channel>::iterator channel_it = channels.find(channel_name);
-    if (channel_it == channels.end())
+    ChannelTable::Id channel_id = channels.find(channel_name);
+    if (channel_id == ChannelTable::NONE)
 	{
-        std::string error = ":ircserv 403 " + users[client_fd].getNickname() + " " + channel_name + " :No such channel\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NOSUCHCHANNEL, channel_name);
         return;
     }
 
-    if (!channel_it->second.hasMember(client_fd))
+    Channel& channel = *channels.get(channel_id);
+
+    if (!channel.hasMember(client_fd))
 	{
-        std::string error = ":ircserv 442 " + users[client_fd].getNickname() + " " + channel_name + " :You're not on that channel\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NOTONCHANNEL, channel.getName());
         return;
     }
 
-    if (!channel_it->second.isOperator(client_fd))
+    if (!channel.isOperator(client_fd))
 	{
-        std::string error = ":ircserv 482 " + users[client_fd].getNickname() + " " + channel_name + " :You're not channel operator\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_CHANOPRIVSNEEDED, channel.getName());
         return;
     }
 
-    int target_fd = -1;
-    for (std::map<int, User>::iterator it = users.begin(); it != users.end(); ++it) {
-        if (it->second.getNickname() == nickname)
-		{
-            target_fd = it->first;
-            break;
-        }
-    }
+    NickIndex::Id target_nick_id = nicks.find(nickname);
+    int target_fd = nicks.owner(target_nick_id);
 
     if (target_fd == -1)
 	{
-        std::string error = ":ircserv 401 " + users[client_fd].getNickname() + " " + nickname + " :No such nick/channel\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NOSUCHNICK, nickname);
         return;
     }
 
-    if (channel_it->second.hasMember(target_fd))
+    if (channel.hasMember(target_fd))
 	{
-        std::string error = ":ircserv 443 " + users[client_fd].getNickname() + " " + nickname + " " + channel_name + " :is already on channel\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_USERONCHANNEL, nicks.name(target_nick_id), channel.getName());
         return;
     }
 
-    channel_it->second.addInvite(target_fd);
+    channel.addInvite(target_fd);
 
-    std::string invite_notification = ":" + users[client_fd].getFullIdentity() + " INVITE " + nickname + " :" + channel_name + "\r\n";
-    send(target_fd, invite_notification.c_str(), invite_notification.length(), 0);
+    std::string invite_notification = ":" + user.getFullIdentity() + " INVITE " + nicks.name(target_nick_id) + " :" + channel.getName() + "\r\n";
+    server->sendToClient(target_fd, invite_notification);
 
-    std::string invite_confirm = ":ircserv 341 " + users[client_fd].getNickname() + " " + nickname + " " + channel_name + "\r\n";
-    send(client_fd, invite_confirm.c_str(), invite_confirm.length(), 0);
+    reply(client_fd, RPL_INVITING, nicks.name(target_nick_id), channel.getName());
 }
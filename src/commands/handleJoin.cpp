@@ -1,110 +1,134 @@
 #include <Command.hpp>
-#include <sys/socket.h>
+#include <Server.hpp>
 
-void Command::handleJoin(int client_fd, std::istringstream& iss)
+void Command::handleJoin(int client_fd, const Message& msg)
 {
-    if (!users[client_fd].isAuthenticated())
+    User& user = connections.user(client_fd);
+
+    if (!user.isAuthenticated())
 	{
-        std::string error = ":ircserv 451 * :You have not registered\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NOTREGISTERED);
         return;
     }
 
-    std::string channel_params;
-    std::getline(iss, channel_params);
-    if (channel_params[0] == ' ') channel_params = channel_params.substr(1);
-
-    std::istringstream channel_iss(channel_params);
-    std::string channel_list;
-    channel_iss >> channel_list;
+    if (msg.paramCount() < 1)
+	{
+        reply(client_fd, ERR_NEEDMOREPARAMS, StringView("JOIN", 4));
+        return;
+    }
 
-    std::istringstream channel_tokens(channel_list);
-    std::string channel_name;
-    while (std::getline(channel_tokens, channel_name, ','))
+    const StringView& channel_list = msg.param(0);
+    size_t start = 0;
+    while (start <= channel_list.size())
 	{
+        size_t comma = start;
+        while (comma < channel_list.size() && channel_list[comma] != ',')
+            ++comma;
+        std::string channel_name(channel_list.data() + start, comma - start);
+        start = comma + 1;
+
         if (channel_name.empty()) continue;
 
         if (channel_name[0] != '#')
-            channel_name = "#" + channel_name;
+            channel_name.insert(0, 1, '#');
 
         bool isNewChannel = false;
-        if (channels.find(channel_name) == channels.end())
+        ChannelTable::Id channel_id = channels.find(channel_name);
+        if (channel_id == ChannelTable::NONE)
 		{
-            channels[channel_name] = Channel(channel_name);
+            channel_id = channels.create(channel_name);
             isNewChannel = true;
         }
 
-        Channel& channel = channels[channel_name];
+        Channel& channel = *channels.get(channel_id);
 
         if (channel.hasMember(client_fd))
 		{
-            std::string error = ":ircserv 443 " + users[client_fd].getNickname() + " " + channel_name + " :is already on channel\r\n";
-            send(client_fd, error.c_str(), error.length(), 0);
+            reply(client_fd, ERR_USERONCHANNEL, nickOf(client_fd), channel.getName());
             continue;
         }
 
         if (!isNewChannel && channel.isInviteOnly() && !channel.isInvited(client_fd) && !channel.hasMember(client_fd))
 		{
-            std::string error = ":ircserv 473 " + users[client_fd].getNickname() + " " + channel_name + " :Cannot join channel (+i)\r\n";
-            send(client_fd, error.c_str(), error.length(), 0);
+            reply(client_fd, ERR_INVITEONLYCHAN, channel.getName());
             continue;
         }
 
         if (!isNewChannel && channel.hasKeySet())
 		{
-            std::string key;
-            std::istringstream key_iss(channel_params);
-            std::string temp;
-            key_iss >> temp >> key;
+            const StringView& key = msg.param(1);
 
-            if (key.empty() || key != channel.getKey())
+            if (key.empty() || key.str() != channel.getKey())
 			{
-                std::string error = ":ircserv 475 " + users[client_fd].getNickname() + " " + channel_name + " :Cannot join channel (+k) - bad key\r\n";
-                send(client_fd, error.c_str(), error.length(), 0);
+                reply(client_fd, ERR_BADCHANNELKEY, channel.getName());
                 continue;
             }
         }
 
-        if (!isNewChannel && channel.hasUserLimitSet() && channel.getMembers().size() >= channel.getUserLimit())
+        if (!isNewChannel && channel.hasUserLimitSet() && channel.getMemberCount() >= channel.getUserLimit())
 		{
-            std::string error = ":ircserv 471 " + users[client_fd].getNickname() + " " + channel_name + " :Cannot join channel (+l) - channel is full\r\n";
-            send(client_fd, error.c_str(), error.length(), 0);
+            reply(client_fd, ERR_CHANNELISFULL, channel.getName());
             continue;
         }
 
         channel.addMember(client_fd);
         channel.removeInvite(client_fd);
+        user.addChannel(channel_id);
 
         if (isNewChannel)
             channel.addOperator(client_fd);
 
-        std::string nick = users[client_fd].getNickname();
-
-        std::string join_notification = ":" + users[client_fd].getFullIdentity() + " JOIN :" + channel_name + "\r\n";
-        channel.broadcastMessage(join_notification);
+        std::string join_notification = ":" + user.getFullIdentity() + " JOIN :" + channel.getName() + "\r\n";
+        channel.broadcastMessage(*server, join_notification);
+        charge(client_fd, channel.getMemberCount() / RECIPIENTS_PER_TOKEN, 0);
 
         if (!channel.getTopic().empty())
 		{
-            std::string topic_reply = ":ircserv 332 " + nick + " " + channel_name + " :" + channel.getTopic() + "\r\n";
-            send(client_fd, topic_reply.c_str(), topic_reply.length(), 0);
+            reply(client_fd, RPL_TOPIC, channel.getName(), channel.getTopic());
         }
 
-        std::string members_list;
-        const std::set<int>& members = channel.getMembers();
-        const std::set<int>& operators = channel.getOperators();
-        for (std::set<int>::const_iterator member_it = members.begin(); member_it != members.end(); ++member_it)
-		{
-            std::string member_nick = users[*member_it].getNickname();
-            if (operators.find(*member_it) != operators.end())
-                members_list += "@" + member_nick + " ";
-            else
-                members_list += member_nick + " ";
-        }
+        sendNames(client_fd, channel);
+    }
+}
 
-        std::string names_reply = ":ircserv 353 " + nick + " = " + channel_name + " :" + members_list + "\r\n";
-        std::string end_names_reply = ":ircserv 366 " + nick + " " + channel_name + " :End of /NAMES list.\r\n";
+// Builds the 353 lines for a requester nick of up to NAMES_NICK_BUDGET bytes
+// from the channel's cached chunks; a longer nick only re-splits the chunks.
+void Command::sendNames(int client_fd, const Channel& channel)
+{
+    const NumericTable& numerics = server->getNumerics();
+    const std::string& channel_name = channel.getName();
+    const std::string& nick = nickOf(client_fd);
+    StringView args[2] = { channel_name, StringView() };
+    size_t prefix_size = numerics.length(RPL_NAMREPLY, nick, args, 2) - 2;
+    size_t reference = prefix_size - nick.size() + NAMES_NICK_BUDGET;
+    size_t chunk_size = InputBuffer::MAX_LINE > reference ? InputBuffer::MAX_LINE - reference : 1;
+    size_t room = InputBuffer::MAX_LINE > prefix_size ? InputBuffer::MAX_LINE - prefix_size : 1;
+
+    const std::vector<std::string>& names = channel.getNames(connections, nicks, chunk_size);
+
+    Reply reply(arena, (names.size() + 1) * (prefix_size + chunk_size + 2));
+    for (size_t i = 0; i < names.size(); ++i)
+	{
+        const std::string& chunk = names[i];
+        size_t start = 0;
+        while (start < chunk.size())
+		{
+            size_t end = chunk.size();
+            if (end - start > room)
+			{
+                end = chunk.rfind(' ', start + room);
+                if (end == std::string::npos || end <= start)
+                    end = chunk.find(' ', start);
+                if (end == std::string::npos)
+                    end = chunk.size();
+            }
 
-        send(client_fd, names_reply.c_str(), names_reply.length(), 0);
-        send(client_fd, end_names_reply.c_str(), end_names_reply.length(), 0);
+            args[1] = StringView(chunk.data() + start, end - start);
+            numerics.render(reply, RPL_NAMREPLY, nick, args, 2);
+            start = end + 1;
+        }
     }
+    appendNumeric(reply, client_fd, RPL_ENDOFNAMES, channel_name);
+
+    server->sendToClient(client_fd, reply.view());
 }
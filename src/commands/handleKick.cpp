@@ -1,82 +1,65 @@
 #include <Command.hpp>
-#include <sys/socket.h>
+#include <Server.hpp>
 
-void Command::handleKick(int client_fd, const std::string& line)
+void Command::handleKick(int client_fd, const Message& msg)
 {
-    if (!users[client_fd].isAuthenticated())
+    User& user = connections.user(client_fd);
+
+    if (!user.isAuthenticated())
 	{
-        std::string error = ":ircserv 451 * :You have not registered\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NOTREGISTERED);
         return;
     }
 
-    std::istringstream iss;
-    if (line.length() > 5)
-        iss.str(line.substr(5));
-
-    std::string channel_name, target_nick;
-
-    iss >> channel_name >> target_nick;
+    std::string channel_name = msg.param(0).str();
+    const StringView& target_nick = msg.param(1);
 
     if (channel_name.empty() || target_nick.empty())
 	{
-        std::string error = ":ircserv 461 " + users[client_fd].getNickname() + " KICK :Not enough parameters\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NEEDMOREPARAMS, StringView("KICK", 4));
         return;
     }
 
     if (channel_name[0] != '#')
-        channel_name = "#" + channel_name;
-
-    std::string kick_message = users[client_fd].getNickname();
-    std::string rest;
-    std::getline(iss, rest);
+        channel_name.insert(0, 1, '#');
 
-    size_t colon_pos = rest.find(':');
-    if (colon_pos != std::string::npos)
-        kick_message = rest.substr(colon_pos + 1);
+    std::string kick_message = nickOf(client_fd);
+    if (msg.paramCount() > 2)
+        kick_message = msg.param(2).str();
 
-    std::map<std::string, Channel>::iterator channel_it = channels.find(channel_name);
-    if (channel_it == channels.end())
+    ChannelTable::Id channel_id = channels.find(channel_name);
+    if (channel_id == ChannelTable::NONE)
 	{
-        std::string error = ":ircserv 403 " + users[client_fd].getNickname() + " " + channel_name + " :No such channel\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NOSUCHCHANNEL, channel_name);
         return;
     }
 
-    if (!channel_it->second.hasMember(client_fd))
+    Channel& channel = *channels.get(channel_id);
+
+    if (!channel.hasMember(client_fd))
 	{
-        std::string error = ":ircserv 442 " + users[client_fd].getNickname() + " " + channel_name + " :You're not on that channel\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NOTONCHANNEL, channel.getName());
         return;
     }
 
-    if (!channel_it->second.isOperator(client_fd))
+    if (!channel.isOperator(client_fd))
 	{
-        std::string error = ":ircserv 482 " + users[client_fd].getNickname() + " " + channel_name + " :You're not channel operator\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_CHANOPRIVSNEEDED, channel.getName());
         return;
     }
 
-    int target_fd = -1;
-    for (std::map<int, User>::iterator it = users.begin(); it != users.end(); ++it)
-	{
-        if (it->second.getNickname() == target_nick)
-		{
-            target_fd = it->first;
-            break;
-        }
-    }
+    NickIndex::Id target_nick_id = nicks.find(target_nick);
+    int target_fd = nicks.owner(target_nick_id);
 
-    if (target_fd == -1 || !channel_it->second.hasMember(target_fd))
+    if (target_fd == -1 || !channel.hasMember(target_fd))
 	{
-        std::string error = ":ircserv 441 " + users[client_fd].getNickname() + " " + target_nick + " " + channel_name + " :They aren't on that channel\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_USERNOTINCHANNEL, target_nick, channel.getName());
         return;
     }
 
-    std::string kick_notification = ":" + users[client_fd].getFullIdentity() + " KICK " + channel_name + " " + target_nick + " :" + kick_message + "\r\n";
-    channel_it->second.broadcastMessage(kick_notification);
+    std::string kick_notification = ":" + user.getFullIdentity() + " KICK " + channel.getName() + " " + nicks.name(target_nick_id) + " :" + kick_message + "\r\n";
+    channel.broadcastMessage(*server, kick_notification);
 
-    channel_it->second.removeMember(target_fd);
+    channel.removeMember(target_fd);
+    connections.user(target_fd).removeChannel(channel_id);
 }
@@ -1,5 +1,5 @@
 #include <Command.hpp>
-#include <sys/socket.h>
+#include <Server.hpp>
 #include <cstdlib>
 
 static void handleModeI(Channel& channel, bool adding, std::string& modeChanges)
@@ -15,16 +15,15 @@ static void handleModeT(Channel& channel, bool adding, std::string& modeChanges)
 }
 
 static void handleModeK(Channel& channel, bool adding, std::string& modeChanges,
-                        std::string& modeParams, std::istringstream& iss,
-                        int client_fd, const std::map<int, User>& users)
+                        std::string& modeParams, const Message& msg, size_t& arg,
+                        int client_fd, Command& command)
 {
     if (adding)
 	{
-        std::string key;
-        if (!(iss >> key) || key.empty())
+        std::string key = msg.param(arg++).str();
+        if (key.empty())
 		{
-            std::string error = ":ircserv 461 " + users.at(client_fd).getNickname() + " MODE :Not enough parameters\r\n";
-            send(client_fd, error.c_str(), error.length(), 0);
+            command.reply(client_fd, ERR_NEEDMOREPARAMS, StringView("MODE", 4));
             return;
         }
         channel.setKey(key);
@@ -39,31 +38,22 @@ static void handleModeK(Channel& channel, bool adding, std::string& modeChanges,
 }
 
 static void handleModeO(Channel& channel, bool adding, std::string& modeChanges,
-                        std::string& modeParams, std::istringstream& iss,
-                        int client_fd, const std::map<int, User>& users)
+                        std::string& modeParams, const Message& msg, size_t& arg,
+                        int client_fd, const NickIndex& nicks, Command& command)
 {
-    std::string target_nick;
-    if (!(iss >> target_nick) || target_nick.empty())
+    const StringView& target_nick = msg.param(arg++);
+    if (target_nick.empty())
 	{
-        std::string error = ":ircserv 461 " + users.at(client_fd).getNickname() + " MODE :Not enough parameters\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        command.reply(client_fd, ERR_NEEDMOREPARAMS, StringView("MODE", 4));
         return;
     }
 
-    int target_fd = -1;
-    for (std::map<int, User>::const_iterator it = users.begin(); it != users.end(); ++it)
-	{
-        if (it->second.getNickname() == target_nick && channel.hasMember(it->first))
-		{
-            target_fd = it->first;
-            break;
-        }
-    }
+    NickIndex::Id target_nick_id = nicks.find(target_nick);
+    int target_fd = nicks.owner(target_nick_id);
 
-    if (target_fd == -1)
+    if (target_fd == -1 || !channel.hasMember(target_fd))
 	{
-        std::string error = ":ircserv 441 " + users.at(client_fd).getNickname() + " " + target_nick + " " + channel.getName() + " :They aren't on that channel\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        command.reply(client_fd, ERR_USERNOTINCHANNEL, target_nick, channel.getName());
         return;
     }
 
@@ -73,15 +63,9 @@ static void handleModeO(Channel& channel, bool adding, std::string& modeChanges,
     }
 	else
 	{
-        int operatorCount = 0;
-        const std::set<int>& ops = channel.getOperators();
-        for (std::set<int>::const_iterator it = ops.begin(); it != ops.end(); ++it)
-            operatorCount++;
-
-        if (operatorCount <= 1 && channel.isOperator(target_fd))
+        if (channel.getOperatorCount() <= 1 && channel.isOperator(target_fd))
 		{
-            std::string error = ":ircserv 482 " + users.at(client_fd).getNickname() + " " + channel.getName() + " :Cannot remove last operator from channel\r\n";
-            send(client_fd, error.c_str(), error.length(), 0);
+            command.reply(client_fd, ERR_LASTCHANOP, channel.getName());
             return;
         }
 
@@ -89,28 +73,26 @@ static void handleModeO(Channel& channel, bool adding, std::string& modeChanges,
     }
 
     modeChanges += "o";
-    modeParams += " " + target_nick;
+    modeParams += " " + nicks.name(target_nick_id);
 }
 
 static void handleModeL(Channel& channel, bool adding, std::string& modeChanges,
-                        std::string& modeParams, std::istringstream& iss,
-                        int client_fd, const std::map<int, User>& users)
+                        std::string& modeParams, const Message& msg, size_t& arg,
+                        int client_fd, Command& command)
 {
     if (adding)
 	{
-        std::string limitStr;
-        if (!(iss >> limitStr) || limitStr.empty())
+        std::string limitStr = msg.param(arg++).str();
+        if (limitStr.empty())
 		{
-            std::string error = ":ircserv 461 " + users.at(client_fd).getNickname() + " MODE :Not enough parameters\r\n";
-            send(client_fd, error.c_str(), error.length(), 0);
+            command.reply(client_fd, ERR_NEEDMOREPARAMS, StringView("MODE", 4));
             return;
         }
 
         int limitInt = atoi(limitStr.c_str());
         if (limitInt <= 0)
 		{
-            std::string error = ":ircserv 461 " + users.at(client_fd).getNickname() + " MODE :Invalid limit value\r\n";
-            send(client_fd, error.c_str(), error.length(), 0);
+            command.reply(client_fd, ERR_INVALIDLIMIT, StringView("MODE", 4));
             return;
         }
         size_t limit = static_cast<size_t>(limitInt);
@@ -125,66 +107,59 @@ static void handleModeL(Channel& channel, bool adding, std::string& modeChanges,
     }
 }
 
-void Command::handleMode(int client_fd, const std::string& line)
+void Command::handleMode(int client_fd, const Message& msg)
 {
-    if (!users.at(client_fd).isAuthenticated())
+    User& user = connections.user(client_fd);
+
+    if (!user.isAuthenticated())
 	{
-        std::string error = ":ircserv 451 * :You have not registered\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NOTREGISTERED);
         return;
     }
 
-    std::istringstream iss;
-    if (line.length() > 5)
-        iss.str(line.substr(5));
-
-    std::string target, modes;
-    iss >> target;
+    std::string target = msg.param(0).str();
 
     if (target.empty())
 	{
-        std::string error = ":ircserv 461 " + users.at(client_fd).getNickname() + " MODE :Not enough parameters\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NEEDMOREPARAMS, StringView("MODE", 4));
         return;
     }
 
-    if (target[0] == '#' && channels.find(target) == channels.end())
+    ChannelTable::Id channel_id = channels.find(target);
+    if (target[0] == '#' && channel_id == ChannelTable::NONE)
 	{
-        std::string error = ":ircserv 403 " + users.at(client_fd).getNickname() + " " + target + " :No such channel\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NOSUCHCHANNEL, target);
         return;
     }
 
     if (target[0] != '#')
 	{
-        std::string error = ":ircserv 502 " + users.at(client_fd).getNickname() + " :Cannot change mode for other users\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_USERSDONTMATCH);
         return;
     }
 
-    Channel& channel = channels[target];
+    Channel& channel = *channels.get(channel_id);
 
-    if (!(iss >> modes))
+    if (msg.paramCount() < 2)
 	{
-        std::string mode_response = ":ircserv 324 " + users.at(client_fd).getNickname() + " " + target + " " + channel.getModeString() + "\r\n";
-        send(client_fd, mode_response.c_str(), mode_response.length(), 0);
+        reply(client_fd, RPL_CHANNELMODEIS, channel.getName(), channel.getModeString());
         return;
     }
 
     if (!channel.hasMember(client_fd))
 	{
-        std::string error = ":ircserv 442 " + users.at(client_fd).getNickname() + " " + target + " :You're not on that channel\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NOTONCHANNEL, channel.getName());
         return;
     }
 
     if (!channel.isOperator(client_fd))
 	{
-        std::string error = ":ircserv 482 " + users.at(client_fd).getNickname() + " " + target + " :You're not channel operator\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_CHANOPRIVSNEEDED, channel.getName());
         return;
     }
 
+    std::string modes = msg.param(1).str();
+    size_t arg = 2;
     bool adding = true;
     std::string modeChanges = "+";
     std::string modeParams = "";
@@ -209,21 +184,21 @@ void Command::handleMode(int client_fd, const std::string& line)
             handleModeT(channel, adding, modeChanges);
         else if (c == 'k')
 		{
-            handleModeK(channel, adding, modeChanges, modeParams, iss, client_fd, users);
+            handleModeK(channel, adding, modeChanges, modeParams, msg, arg, client_fd, *this);
         }
         else if (c == 'o')
 		{
-            handleModeO(channel, adding, modeChanges, modeParams, iss, client_fd, users);
+            handleModeO(channel, adding, modeChanges, modeParams, msg, arg, client_fd, nicks, *this);
         }
         else if (c == 'l')
 		{
-            handleModeL(channel, adding, modeChanges, modeParams, iss, client_fd, users);
+            handleModeL(channel, adding, modeChanges, modeParams, msg, arg, client_fd, *this);
         }
     }
 
     if (modeChanges.length() > 1)
 	{
-        std::string mode_notification = ":" + users.at(client_fd).getFullIdentity() + " MODE " + target + " " + modeChanges + modeParams + "\r\n";
-        channel.broadcastMessage(mode_notification);
+        std::string mode_notification = ":" + user.getFullIdentity() + " MODE " + channel.getName() + " " + modeChanges + modeParams + "\r\n";
+        channel.broadcastMessage(*server, mode_notification);
     }
 }
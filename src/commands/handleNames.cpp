@@ -0,0 +1,45 @@
+#include <Command.hpp>
+#include <Server.hpp>
+
+// Without a channel only the end of list is sent, rather than every channel.
+void Command::handleNames(int client_fd, const Message& msg)
+{
+    User& user = connections.user(client_fd);
+
+    if (!user.isAuthenticated())
+	{
+        reply(client_fd, ERR_NOTREGISTERED);
+        return;
+    }
+
+    if (msg.paramCount() < 1 || msg.param(0).empty())
+	{
+        reply(client_fd, RPL_ENDOFNAMES, StringView("*", 1));
+        return;
+    }
+
+    const StringView& channel_list = msg.param(0);
+    size_t start = 0;
+    while (start <= channel_list.size())
+	{
+        size_t comma = start;
+        while (comma < channel_list.size() && channel_list[comma] != ',')
+            ++comma;
+        std::string channel_name(channel_list.data() + start, comma - start);
+        start = comma + 1;
+
+        if (channel_name.empty())
+            continue;
+
+        if (channel_name[0] != '#')
+            channel_name.insert(0, 1, '#');
+
+        ChannelTable::Id channel_id = channels.find(channel_name);
+        if (channel_id != ChannelTable::NONE)
+            sendNames(client_fd, *channels.get(channel_id));
+        else
+		{
+            reply(client_fd, RPL_ENDOFNAMES, channel_name);
+        }
+    }
+}
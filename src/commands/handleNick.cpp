@@ -1,56 +1,58 @@
 #include <Command.hpp>
-#include <sys/socket.h>
+#include <Server.hpp>
 
-void Command::handleNick(int client_fd, std::istringstream& iss)
+void Command::handleNick(int client_fd, const Message& msg)
 {
-    std::string nickname;
-    if (std::getline(iss, nickname) && !nickname.empty())
-	{
-        if (nickname[0] == ' ') nickname = nickname.substr(1);
+    User& user = connections.user(client_fd);
 
-        size_t crlf = nickname.find_first_of("\r\n");
-        if (crlf != std::string::npos)
-            nickname = nickname.substr(0, crlf);
+    if (msg.paramCount() > 0)
+	{
+        std::string nickname = msg.param(0).str();
 
         if (nickname.empty() || nickname.find(' ') != std::string::npos)
 		{
-            std::string error = ":ircserv 432 * :Erroneous nickname\r\n";
-            send(client_fd, error.c_str(), error.length(), 0);
+            reply(client_fd, ERR_ERRONEUSNICKNAME);
         }
 		else
 		{
-            bool nickname_in_use = false;
-            for (std::map<int, User>::iterator it = users.begin(); it != users.end(); ++it) {
-                if (it->first != client_fd && it->second.getNickname() == nickname)
-				{
-                    nickname_in_use = true;
-                    break;
-                }
-            }
+            NickIndex::Id nick_id = nicks.find(nickname);
+            int owner_fd = nicks.owner(nick_id);
 
-            if (nickname_in_use)
+            if (owner_fd != -1 && owner_fd != client_fd)
 			{
-                std::string error = ":ircserv 433 * " + nickname + " :Nickname is already in use\r\n";
-                send(client_fd, error.c_str(), error.length(), 0);
+                reply(client_fd, ERR_NICKNAMEINUSE, nickname);
             }
 			else
 			{
-                std::string old_nick = users[client_fd].getNickname();
-                users[client_fd].setNickname(nickname);
+                bool had_nick = user.hasNickname();
+                std::string old_identity = user.getFullIdentity();
+                // A change of case keeps the id and only respells it.
+                if (user.getNick() != nick_id)
+                    nicks.remove(user.getNick(), client_fd);
+                nick_id = nicks.add(nickname, client_fd);
+                user.setNickname(nick_id, nicks.name(nick_id));
+
+                const std::vector<unsigned int>& joined = user.getChannels();
+                for (size_t i = 0; i < joined.size(); ++i)
+				{
+                    Channel* channel = channels.get(joined[i]);
+                    if (channel)
+                        channel->invalidateNames();
+                }
 
                 std::string response;
-                if (old_nick.empty())
+                if (!had_nick)
                     response = ":" + nickname + " NICK :" + nickname + "\r\n";
 				else
-                    response = ":" + old_nick + "!~" + users[client_fd].getUsername() + "@localhost NICK :" + nickname + "\r\n";
-                send(client_fd, response.c_str(), response.length(), 0);
+                    response = ":" + old_identity + " NICK :" + nickname + "\r\n";
+                server->sendToClient(client_fd, response);
 
-                if (!users[client_fd].getUsername().empty() &&
-                    users[client_fd].isPasswordVerified() &&
-                    !users[client_fd].isAuthenticated())
+                if (!user.getUsername().empty() &&
+                    user.isPasswordVerified() &&
+                    !user.isAuthenticated())
 				{
-                    users[client_fd].setAuthenticated(true);
-                    sendWelcomeMessages(client_fd, users[client_fd]);
+                    user.setAuthenticated(true);
+                    sendWelcomeMessages(client_fd, user);
                 }
             }
         }
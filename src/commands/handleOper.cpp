@@ -0,0 +1,35 @@
+#include <Command.hpp>
+#include <Server.hpp>
+
+void Command::handleOper(int client_fd, const Message& msg)
+{
+    User& user = connections.user(client_fd);
+
+    if (!user.isAuthenticated())
+	{
+        reply(client_fd, ERR_NOTREGISTERED);
+        return;
+    }
+
+    if (msg.paramCount() < 2)
+	{
+        reply(client_fd, ERR_NEEDMOREPARAMS, StringView("OPER", 4));
+        return;
+    }
+
+    const ServerConfig& config = server->getConfig();
+    if (config.oper_name.empty())
+	{
+        reply(client_fd, ERR_NOOPERHOST);
+        return;
+    }
+
+    if (msg.param(0).str() != config.oper_name || msg.param(1).str() != config.oper_password)
+	{
+        reply(client_fd, ERR_PASSWDMISMATCH);
+        return;
+    }
+
+    user.setIrcOperator(true);
+    reply(client_fd, RPL_YOUREOPER);
+}
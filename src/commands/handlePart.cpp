@@ -1,95 +1,71 @@
 #include <Command.hpp>
-#include <sys/socket.h>
+#include <Server.hpp>
 
-void Command::handlePart(int client_fd, const std::string& line)
+void Command::handlePart(int client_fd, const Message& msg)
 {
-    if (!users[client_fd].isAuthenticated())
+    User& user = connections.user(client_fd);
+
+    if (!user.isAuthenticated())
 	{
-        std::string error = ":ircserv 451 * :You have not registered\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NOTREGISTERED);
         return;
     }
 
-    std::istringstream iss;
-    if (line.length() > 5)
-        iss.str(line.substr(5));
-
-    std::string channel_params;
-    iss >> channel_params;
-
-    if (channel_params[0] == ' ') channel_params = channel_params.substr(1);
-
-    std::istringstream channel_iss(channel_params);
-    std::string channel_list;
-    channel_iss >> channel_list;
+    if (msg.paramCount() < 1)
+	{
+        reply(client_fd, ERR_NEEDMOREPARAMS, StringView("PART", 4));
+        return;
+    }
 
     std::string part_message = "Leaving";
-    size_t colon_pos = channel_params.find(" :");
-    if (colon_pos != std::string::npos)
-        part_message = channel_params.substr(colon_pos + 2);
+    if (msg.paramCount() > 1)
+        part_message = msg.param(1).str();
 
-    std::istringstream channel_tokens(channel_list);
-    std::string channel_name;
-    while (std::getline(channel_tokens, channel_name, ','))
+    const StringView& channel_list = msg.param(0);
+    size_t start = 0;
+    while (start <= channel_list.size())
 	{
+        size_t comma = start;
+        while (comma < channel_list.size() && channel_list[comma] != ',')
+            ++comma;
+        std::string channel_name(channel_list.data() + start, comma - start);
+        start = comma + 1;
+
         if (channel_name.empty()) continue;
 
         if (channel_name[0] != '#')
-            channel_name = "#" + channel_name;
+            channel_name.insert(0, 1, '#');
 
-        std::map<std::string, Channel>::iterator channel_it = channels.find(channel_name);
-        if (channel_it == channels.end())
+        ChannelTable::Id channel_id = channels.find(channel_name);
+        if (channel_id == ChannelTable::NONE)
 		{
-            std::string error = ":ircserv 403 " + users[client_fd].getNickname() + " " + channel_name + " :No such channel\r\n";
-            send(client_fd, error.c_str(), error.length(), 0);
+            reply(client_fd, ERR_NOSUCHCHANNEL, channel_name);
             continue;
         }
 
-        if (!channel_it->second.hasMember(client_fd))
+        Channel& channel = *channels.get(channel_id);
+        if (!channel.hasMember(client_fd))
 		{
-            std::string error = ":ircserv 442 " + users[client_fd].getNickname() + " " + channel_name + " :You're not on that channel\r\n";
-            send(client_fd, error.c_str(), error.length(), 0);
+            reply(client_fd, ERR_NOTONCHANNEL, channel.getName());
             continue;
         }
 
-        bool isOp = channel_it->second.isOperator(client_fd);
-
-        if (isOp)
+        int newOp = channel.operatorSuccessor(client_fd);
+        if (newOp != -1)
 		{
-            int operatorCount = 0;
-            for (std::set<int>::const_iterator it = channel_it->second.getOperators().begin();
-                 it != channel_it->second.getOperators().end(); ++it)
-                operatorCount++;
-
-            if (operatorCount == 1 && channel_it->second.getMembers().size() > 1)
-			{
-                int newOp = -1;
-                for (std::set<int>::const_iterator it = channel_it->second.getMembers().begin();
-                     it != channel_it->second.getMembers().end(); ++it)
-				{
-                    if (*it != client_fd)
-					{
-                        newOp = *it;
-                        break;
-                    }
-                }
-
-                if (newOp != -1)
-				{
-                    channel_it->second.addOperator(newOp);
+            channel.addOperator(newOp);
 
-                    std::string mode_notification = ":ircserv MODE " + channel_name + " +o " + users[newOp].getNickname() + "\r\n";
-                    channel_it->second.broadcastMessage(mode_notification);
-                }
-            }
+            std::string mode_notification = ":" + server->getConfig().server_name + " MODE " + channel.getName() + " +o " + nickOf(newOp) + "\r\n";
+            channel.broadcastMessage(*server, mode_notification);
         }
 
-        std::string part_notification = ":" + users[client_fd].getFullIdentity() + " PART " + channel_name + " :" + part_message + "\r\n";
-        channel_it->second.broadcastMessage(part_notification);
+        std::string part_notification = ":" + user.getFullIdentity() + " PART " + channel.getName() + " :" + part_message + "\r\n";
+        channel.broadcastMessage(*server, part_notification);
 
-        channel_it->second.removeMember(client_fd);
+        channel.removeMember(client_fd);
+        user.removeChannel(channel_id);
 
-        if (channel_it->second.isEmpty())
-            channels.erase(channel_it);
+        if (channel.isEmpty())
+            channels.erase(channel_id);
     }
 }
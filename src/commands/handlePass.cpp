@@ -1,22 +1,17 @@
 #include <Command.hpp>
-#include <sys/socket.h>
+#include <Server.hpp>
 
-void Command::handlePass(int client_fd, std::istringstream& iss)
+void Command::handlePass(int client_fd, const Message& msg)
 {
-    std::string pass;
-    if (std::getline(iss, pass) && !pass.empty())
+    if (msg.paramCount() > 0 && !msg.param(0).empty())
 	{
-        if (pass[0] == ' ') pass = pass.substr(1);
-        size_t crlf = pass.find_first_of("\r\n");
-        if (crlf != std::string::npos)
-            pass = pass.substr(0, crlf);
+        std::string pass = msg.param(0).str();
 
         if (pass == password)
-            users[client_fd].setPasswordVerified(true);
+            connections.user(client_fd).setPasswordVerified(true);
         else
 		{
-            std::string error = ":ircserv 464 * :Password incorrect\r\n";
-            send(client_fd, error.c_str(), error.length(), 0);
+            reply(client_fd, ERR_PASSWDMISMATCH);
         }
     }
 }
@@ -0,0 +1,17 @@
+#include <Command.hpp>
+#include <Server.hpp>
+
+// Answered before registration too, since clients may check the link early.
+void Command::handlePing(int client_fd, const Message& msg)
+{
+    if (msg.paramCount() < 1 || msg.param(0).empty())
+	{
+        reply(client_fd, ERR_NOORIGIN);
+        return;
+    }
+
+    const std::string& server_name = server->getConfig().server_name;
+    Reply pong(arena);
+    pong.add(':').add(server_name).add(" PONG", 5).param(server_name).trailing(msg.param(0)).end();
+    server->sendToClient(client_fd, pong.view());
+}
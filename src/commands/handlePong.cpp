@@ -0,0 +1,9 @@
+#include <Command.hpp>
+#include <Server.hpp>
+
+// Nothing to do: the reactor counts any input as an answer to its keepalive PING.
+void Command::handlePong(int client_fd, const Message& msg)
+{
+    if (msg.paramCount() < 1 || msg.param(0).empty())
+        reply(client_fd, ERR_NOORIGIN);
+}
@@ -1,66 +1,52 @@
 #include <Command.hpp>
-#include <sys/socket.h>
+#include <Server.hpp>
 
-void Command::handlePrivmsg(int client_fd, std::istringstream& iss)
+void Command::handlePrivmsg(int client_fd, const Message& msg)
 {
-    if (!users[client_fd].isAuthenticated())
+    User& user = connections.user(client_fd);
+
+    if (!user.isAuthenticated())
 	{
-        std::string error = ":ircserv 451 * :You have not registered\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NOTREGISTERED);
         return;
     }
 
-    std::string target;
-    iss >> target;
-
-    std::string message;
-    std::getline(iss, message);
-    if (message.empty()) return;
+    const StringView& target = msg.param(0);
 
-    if (message[0] == ' ') message = message.substr(1);
+    StringView text = msg.textFrom(1);
+    if (text.empty()) return;
 
-    if (message[0] == ':') message = message.substr(1);
+    Reply notification(arena, user.getFullIdentity().size() + target.size() + text.size() + 16);
+    notification.add(':').add(user.getFullIdentity()).add(" PRIVMSG", 8).param(target).trailing(text).end();
 
-    std::string sender = users[client_fd].getNickname();
-    std::string msg_notification = ":" + users[client_fd].getFullIdentity() + " PRIVMSG " + target + " :" + message + "\r\n";
-
-    if (target[0] == '#')
+    if (!target.empty() && target[0] == '#')
 	{
-        std::map<std::string, Channel>::iterator channel_it = channels.find(target);
-        if (channel_it != channels.end())
+        Channel* channel = channels.get(channels.find(target));
+        if (channel)
 		{
-            if (!channel_it->second.hasMember(client_fd))
+            if (!channel->hasMember(client_fd))
 			{
-                std::string error = ":ircserv 442 " + sender + " " + target + " :You're not on that channel\r\n";
-                send(client_fd, error.c_str(), error.length(), 0);
+                reply(client_fd, ERR_NOTONCHANNEL, target);
                 return;
             }
 
-            channel_it->second.broadcastMessage(msg_notification, client_fd);
+            channel->broadcastMessage(*server, SharedBuffer(notification.data(), notification.size()), client_fd);
+            charge(client_fd, channel->getMemberCount() / RECIPIENTS_PER_TOKEN, 0);
         }
 		else
 		{
-            std::string error = ":ircserv 403 " + sender + " " + target + " :No such channel\r\n";
-            send(client_fd, error.c_str(), error.length(), 0);
+            reply(client_fd, ERR_NOSUCHCHANNEL, target);
         }
     }
     else
 	{
-        bool user_found = false;
-        for (std::map<int, User>::iterator it = users.begin(); it != users.end(); ++it)
-		{
-            if (it->second.getNickname() == target)
-			{
-                user_found = true;
-                send(it->first, msg_notification.c_str(), msg_notification.length(), 0);
-                break;
-            }
-        }
+        int target_fd = nicks.owner(nicks.find(target));
 
-        if (!user_found)
+        if (target_fd != -1)
+            server->sendToClient(target_fd, notification.view());
+        else
 		{
-            std::string error = ":ircserv 401 " + sender + " " + target + " :No such nick/channel\r\n";
-            send(client_fd, error.c_str(), error.length(), 0);
+            reply(client_fd, ERR_NOSUCHNICK, target);
         }
     }
 }
@@ -0,0 +1,68 @@
+#include <Command.hpp>
+#include <Server.hpp>
+#include <Metrics.hpp>
+#include <cstdio>
+#include <vector>
+
+void Command::handleStats(int client_fd, const Message& msg)
+{
+    User& user = connections.user(client_fd);
+
+    if (!user.isAuthenticated())
+	{
+        reply(client_fd, ERR_NOTREGISTERED);
+        return;
+    }
+
+    if (!user.isIrcOperator())
+	{
+        reply(client_fd, ERR_NOPRIVILEGES);
+        return;
+    }
+
+    if (msg.paramCount() < 1 || msg.param(0).empty())
+	{
+        reply(client_fd, ERR_NEEDMOREPARAMS, StringView("STATS", 5));
+        return;
+    }
+
+    char letter = msg.param(0)[0];
+    Reply report(arena, 512);
+
+    if (letter == 'm')
+	{
+        // Usage per command: count, bytes received, remote count (always 0 here).
+        for (size_t i = 0; i < ROUTE_SLOTS; ++i)
+		{
+            if (routes[i].handler == NULL || routes[i].latency->getCount() == 0)
+                continue;
+            char count[24];
+            char bytes[24];
+            int count_length = snprintf(count, sizeof(count), "%lu", routes[i].latency->getCount());
+            int bytes_length = snprintf(bytes, sizeof(bytes), "%lu", routes[i].bytes->get());
+            appendNumeric(report, client_fd, RPL_STATSCOMMANDS, StringView(routes[i].verb, routes[i].length),
+                          StringView(count, count_length), StringView(bytes, bytes_length));
+        }
+    }
+    else if (letter == 'u')
+	{
+        time_t up = time(NULL) - Metrics::startTime();
+        char uptime[64];
+        int length = snprintf(uptime, sizeof(uptime), "%ld days %ld:%02ld:%02ld",
+                              static_cast<long>(up / 86400), static_cast<long>(up / 3600 % 24),
+                              static_cast<long>(up / 60 % 60), static_cast<long>(up % 60));
+        appendNumeric(report, client_fd, RPL_STATSUPTIME, StringView(uptime, length));
+    }
+    else if (letter == 'z')
+	{
+        server->refreshMetrics();
+
+        std::vector<std::string> lines;
+        Metrics::summarize(lines);
+        for (size_t i = 0; i < lines.size(); ++i)
+            appendNumeric(report, client_fd, RPL_STATSDEBUG, lines[i]);
+    }
+
+    appendNumeric(report, client_fd, RPL_ENDOFSTATS, StringView(&letter, 1));
+    server->sendToClient(client_fd, report.view());
+}
@@ -1,80 +1,65 @@
 #include <Command.hpp>
-#include <sys/socket.h>
+#include <Server.hpp>
 
-void Command::handleTopic(int client_fd, const std::string& line)
+void Command::handleTopic(int client_fd, const Message& msg)
 {
-    if (!users[client_fd].isAuthenticated())
+    User& user = connections.user(client_fd);
+
+    if (!user.isAuthenticated())
 	{
-        std::string error = ":ircserv 451 * :You have not registered\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NOTREGISTERED);
         return;
     }
 
-    std::istringstream iss;
-    if (line.length() > 6)
-        iss.str(line.substr(6));
-    std::string channel_name;
-    iss >> channel_name;
+    std::string channel_name = msg.param(0).str();
 
     if (channel_name.empty())
 	{
-        std::string error = ":ircserv 461 " + users[client_fd].getNickname() + " TOPIC :Not enough parameters\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NEEDMOREPARAMS, StringView("TOPIC", 5));
         return;
     }
 
     if (channel_name[0] != '#')
-        channel_name = "#" + channel_name;
+        channel_name.insert(0, 1, '#');
 
-    std::map<std::string, Channel>::iterator channel_it = channels.find(channel_name);
-    if (channel_it == channels.end())
+    ChannelTable::Id channel_id = channels.find(channel_name);
+    if (channel_id == ChannelTable::NONE)
 	{
-        std::string error = ":ircserv 403 " + users[client_fd].getNickname() + " " + channel_name + " :No such channel\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NOSUCHCHANNEL, channel_name);
         return;
     }
 
-    if (!channel_it->second.hasMember(client_fd))
+    Channel& channel = *channels.get(channel_id);
+
+    if (!channel.hasMember(client_fd))
 	{
-        std::string error = ":ircserv 442 " + users[client_fd].getNickname() + " " + channel_name + " :You're not on that channel\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_NOTONCHANNEL, channel.getName());
         return;
     }
 
-    std::string rest;
-    std::getline(iss, rest);
-
-    if (rest.empty() || rest == " ")
+    if (msg.paramCount() < 2)
 	{
-        if (channel_it->second.getTopic().empty())
+        if (channel.getTopic().empty())
 		{
-            std::string no_topic = ":ircserv 331 " + users[client_fd].getNickname() + " " + channel_name + " :No topic is set\r\n";
-            send(client_fd, no_topic.c_str(), no_topic.length(), 0);
+            reply(client_fd, RPL_NOTOPIC, channel.getName());
         }
 		else
 		{
-            std::string topic_reply = ":ircserv 332 " + users[client_fd].getNickname() + " " + channel_name + " :" + channel_it->second.getTopic() + "\r\n";
-            send(client_fd, topic_reply.c_str(), topic_reply.length(), 0);
+            reply(client_fd, RPL_TOPIC, channel.getName(), channel.getTopic());
         }
         return;
     }
 
-    if (channel_it->second.isTopicRestricted() && !channel_it->second.isOperator(client_fd))
+    if (channel.isTopicRestricted() && !channel.isOperator(client_fd))
 	{
-        std::string error = ":ircserv 482 " + users[client_fd].getNickname() + " " + channel_name + " :You're not channel operator\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_CHANOPRIVSNEEDED, channel.getName());
         return;
     }
 
-    std::string new_topic;
-    size_t colon_pos = rest.find(':');
-    if (colon_pos != std::string::npos)
-        new_topic = rest.substr(colon_pos + 1);
-    else if (rest[0] == ' ')
-        new_topic = rest.substr(1);
+    std::string new_topic = msg.textFrom(1).str();
 
-    channel_it->second.setTopic(new_topic);
+    channel.setTopic(new_topic);
 
-    std::string topic_notification = ":" + users[client_fd].getFullIdentity() + " TOPIC " + channel_name + " :" + new_topic + "\r\n";
-    channel_it->second.broadcastMessage(topic_notification);
+    std::string topic_notification = ":" + user.getFullIdentity() + " TOPIC " + channel.getName() + " :" + new_topic + "\r\n";
+    channel.broadcastMessage(*server, topic_notification);
 }
@@ -1,33 +1,25 @@
 #include <Command.hpp>
-#include <sys/socket.h>
+#include <Server.hpp>
 
-void Command::handleUser(int client_fd, const std::string& line)
+void Command::handleUser(int client_fd, const Message& msg)
 {
-    if (!users[client_fd].isPasswordVerified())
+    User& user = connections.user(client_fd);
+
+    if (!user.isPasswordVerified())
 	{
-        std::string error = ":ircserv 464 * :Password required before registration\r\n";
-        send(client_fd, error.c_str(), error.length(), 0);
+        reply(client_fd, ERR_PASSWDREQUIRED);
         return;
     }
 
-    std::string params = line.substr(5);
-    std::istringstream params_iss(params);
-    std::string username, mode, unused;
-    params_iss >> username >> mode >> unused;
-
-    std::string realname;
-    if (std::getline(params_iss, realname) && !realname.empty())
-	{
-        if (realname[0] == ' ') realname = realname.substr(1);
-        if (realname[0] == ':') realname = realname.substr(1);
-    }
+    std::string username = msg.param(0).str();
+    std::string realname = msg.param(3).str();
 
-    users[client_fd].setUsername(username);
-    users[client_fd].setRealname(realname);
+    user.setUsername(username);
+    user.setRealname(realname);
 
-    if (!users[client_fd].getNickname().empty() && !users[client_fd].isAuthenticated())
+    if (user.hasNickname() && !user.isAuthenticated())
 	{
-        users[client_fd].setAuthenticated(true);
-        sendWelcomeMessages(client_fd, users[client_fd]);
+        user.setAuthenticated(true);
+        sendWelcomeMessages(client_fd, user);
     }
 }
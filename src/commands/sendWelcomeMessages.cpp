@@ -1,16 +1,16 @@
 #include <Command.hpp>
-#include <sys/socket.h>
+#include <Server.hpp>
 
 
 void Command::sendWelcomeMessages(int client_fd, const User& user)
 {
-    std::string welcome = ":ircserv 001 " + user.getNickname() + " :Welcome to the IRC Network " + user.getFullIdentity() + "\r\n";
-    std::string yourhost = ":ircserv 002 " + user.getNickname() + " :Your host is ircserv, running version 1.0\r\n";
-    std::string created = ":ircserv 003 " + user.getNickname() + " :This server was created Apr 2025\r\n";
-    std::string myinfo = ":ircserv 004 " + user.getNickname() + " ircserv 1.0 o o\r\n";
+    Reply welcome(arena, 512);
+    appendNumeric(welcome, client_fd, RPL_WELCOME, user.getFullIdentity());
+    appendNumeric(welcome, client_fd, RPL_YOURHOST);
+    appendNumeric(welcome, client_fd, RPL_CREATED);
+    appendNumeric(welcome, client_fd, RPL_MYINFO);
+    // Nicknames and channel names compare under the case mapping of CaseMapping.hpp.
+    appendNumeric(welcome, client_fd, RPL_ISUPPORT);
 
-    send(client_fd, welcome.c_str(), welcome.length(), 0);
-    send(client_fd, yourhost.c_str(), yourhost.length(), 0);
-    send(client_fd, created.c_str(), created.length(), 0);
-    send(client_fd, myinfo.c_str(), myinfo.length(), 0);
+    server->sendToClient(client_fd, welcome.view());
 }
@@ -1,21 +1,26 @@
 #include <iostream>
-#include <cstdlib>
 #include <Server.hpp>
-#include <cstdlib>
+#include <ServerConfig.hpp>
+#include <Logger.hpp>
 
 int main(int argc, char **argv)
 {
-	if (argc != 3)
+	ServerConfig config;
+
+	if (!parseServerConfig(argc, argv, config))
 	{
-		std::cerr << "Usage: " << argv[0] << " <port> <password>" << std::endl;
+		printServerUsage(argv[0]);
 		return 1;
 	}
 
-	int port = std::atoi(argv[1]);
-	std::string password = argv[2];
+	if (!Logger::start(config.log_level, config.log_file))
+		return 1;
 
-	Server server(port, password);
-	server.run();
+	{
+		Server server(config);
+		server.run();
+	}
 
+	Logger::stop();
 	return 0;
 }
@@ -157,8 +157,12 @@ int main(int argc, char **argv)
 
     pthread_detach(bot_thread);
 
+    ServerConfig config;
+    config.port = port;
+    config.password = password;
+
     std::cout << "start serveur IRC..." << std::endl;
-    Server server(port, password);
+    Server server(config);
     server.run();
 
     std::cout << "Serveur IRC stop" << std::endl;